@@ -0,0 +1,303 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include "signal_core.h"
+#include "signal_codes.h"
+#include "signal_source.h"
+#include "signal_spectrum.h"
+#include "signal_pipeline.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define SIGNAL_X86 1
+#endif
+using namespace std;
+
+// Throughput benchmark for the encoders, scramblers, decoders, modulators and
+// analysis passes. Prints one CSV row (or one JSON object per line with
+// --json) per function, input pattern and size, so runs can be diffed
+// between releases.
+
+//PATTERNS:-
+
+enum Pattern { PATTERN_RANDOM, PATTERN_ZEROS, PATTERN_ALTERNATING, PATTERN_ZERO_RUNS };
+const char* patternNames[] = { "random", "zeros", "alternating", "zero-runs" };
+
+void makeBits(Pattern pattern, size_t n, BitStream& bits, mt19937_64& rng) {
+    bits.clear();
+    bits.resize(n);
+    size_t nWords = bits.words.size();
+    for (size_t w = 0; w < nWords; w++) {
+        if (pattern == PATTERN_RANDOM) bits.words[w] = rng();
+        else if (pattern == PATTERN_ALTERNATING) bits.words[w] = 0xAAAAAAAAAAAAAAAAULL;
+    }
+    if (pattern == PATTERN_ZERO_RUNS) {
+        // Single pulses separated by 16 to 511 zeros, like a mostly idle line.
+        for (size_t i = rng() % 16; i < n; i += 16 + rng() % 496) bits.set(i, 1);
+    }
+    bits.resize(n);
+}
+
+// Analog input with the same character as the bit pattern.
+void makeAnalog(Pattern pattern, size_t samples, vector<double>& analog, mt19937_64& rng) {
+    analog.resize(samples);
+    uniform_real_distribution<double> noise(-1.0, 1.0);
+    for (size_t i = 0; i < samples; i++) {
+        switch (pattern) {
+            case PATTERN_RANDOM: analog[i] = noise(rng); break;
+            case PATTERN_ZEROS: analog[i] = 0.0; break;
+            case PATTERN_ALTERNATING: analog[i] = (i & 1) ? 1.0 : -1.0; break;
+            default: analog[i] = (rng() % 64 == 0) ? 1.0 : 0.0; break;
+        }
+    }
+}
+
+//TIMING:-
+
+static inline uint64_t readCycles() {
+#ifdef SIGNAL_X86
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Timing {
+    double seconds;     // best single run
+    uint64_t cycles;    // TSC ticks of that run
+    int reps;
+};
+
+// Runs fn once to warm caches, then repeatedly until minSeconds have passed,
+// and keeps the fastest run.
+template <class Fn>
+Timing measure(Fn fn, double minSeconds) {
+    Timing best = { 1e300, 0, 0 };
+    fn();
+    double total = 0.0;
+    while (best.reps < 3 || (total < minSeconds && best.reps < 1000000)) {
+        uint64_t c0 = readCycles();
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        fn();
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        uint64_t c1 = readCycles();
+        double s = chrono::duration<double>(t1 - t0).count();
+        if (s < best.seconds) {
+            best.seconds = s;
+            best.cycles = c1 - c0;
+        }
+        total += s;
+        best.reps++;
+    }
+    return best;
+}
+
+//REPORT:-
+
+bool jsonOutput = false;
+
+void printHeader() {
+    if (!jsonOutput) puts("function,pattern,bits,reps,seconds,ns_per_bit,bits_per_sec,cycles_per_bit");
+}
+
+void report(const string& name, Pattern pattern, size_t bits, const Timing& t) {
+    double nsPerBit = t.seconds * 1e9 / bits;
+    double bitsPerSec = bits / t.seconds;
+    double cyclesPerBit = (double)t.cycles / bits;
+    char line[512];
+    if (jsonOutput) {
+        snprintf(line, sizeof(line),
+                 "{\"function\":\"%s\",\"pattern\":\"%s\",\"bits\":%llu,\"reps\":%d,"
+                 "\"seconds\":%.9g,\"ns_per_bit\":%.6g,\"bits_per_sec\":%.6g,\"cycles_per_bit\":%.6g}",
+                 name.c_str(), patternNames[pattern], (unsigned long long)bits, t.reps,
+                 t.seconds, nsPerBit, bitsPerSec, cyclesPerBit);
+    } else {
+        snprintf(line, sizeof(line), "%s,%s,%llu,%d,%.9g,%.6g,%.6g,%.6g",
+                 name.c_str(), patternNames[pattern], (unsigned long long)bits, t.reps,
+                 t.seconds, nsPerBit, bitsPerSec, cyclesPerBit);
+    }
+    puts(line);
+    fflush(stdout);
+}
+
+//MAIN:-
+
+void usage() {
+    cerr << "Usage: signal_bench [--min-bits N] [--max-bits N] [--min-time SECONDS]\n"
+            "                    [--threads N] [--filter TEXT] [--json]\n"
+            "Sizes grow by 8x from --min-bits (default 64) to --max-bits\n"
+            "(default 16777216; 8589934592 is a 1 GiB packed input). Above\n"
+            "134217728 bits only the packed and streamed paths are timed.\n";
+}
+
+int main(int argc, char** argv) {
+    size_t minBits = 64, maxBits = (size_t)1 << 24;
+    double minTime = 0.2;
+    unsigned threads = 0;
+    string filter;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--min-bits" && hasValue) minBits = strtoull(argv[++i], NULL, 10);
+        else if (arg == "--max-bits" && hasValue) maxBits = strtoull(argv[++i], NULL, 10);
+        else if (arg == "--min-time" && hasValue) minTime = atof(argv[++i]);
+        else if (arg == "--threads" && hasValue) threads = (unsigned)atoi(argv[++i]);
+        else if (arg == "--filter" && hasValue) filter = argv[++i];
+        else if (arg == "--json") jsonOutput = true;
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (minBits == 0) minBits = 64;
+
+    struct SingleShot {
+        LineCode code;
+        const char* name;
+        void (*encode)(BitView, int*);
+    };
+    const SingleShot singleShot[] = {
+        { LINE_NRZL, "encodeNRZL", encodeNRZL },
+        { LINE_NRZI, "encodeNRZI", encodeNRZI },
+        { LINE_MANCHESTER, "encodeManchester", encodeManchester },
+        { LINE_DIFF_MANCHESTER, "encodeDiffManchester", encodeDiffManchester },
+        { LINE_AMI, "encodeAMI", encodeAMI },
+        { LINE_B8ZS, "scrambleB8ZS", scrambleB8ZS },
+        { LINE_HDB3, "scrambleHDB3", scrambleHDB3 }
+    };
+    const size_t singleShotCount = sizeof(singleShot) / sizeof(singleShot[0]);
+    // Int symbols and double samples take 8 to 16 bytes per bit, against
+    // at most 4 for the packed paths, so past this many bits (1 GiB of
+    // Manchester ints) they are left out.
+    const size_t maxUnpackedBits = (size_t)1 << 27;
+
+    mt19937_64 rng(12345);
+    printHeader();
+
+    for (size_t n = minBits; n <= maxBits; n *= 8) {
+        bool unpacked = n <= maxUnpackedBits;
+        vector<int> symbols(unpacked ? 2 * n : 0);
+        BitStream bits, decoded;
+        SymbolStream packed;
+        vector<double> analog, restored;
+
+        for (int p = 0; p < 4; p++) {
+            Pattern pattern = (Pattern)p;
+            makeBits(pattern, n, bits, rng);
+
+#define BENCH(name, call) \
+            if (filter.empty() || string(name).find(filter) != string::npos) \
+                report(name, pattern, n, measure([&]() { call; }, minTime))
+
+            for (int c = 0; c < lineCodeCount; c++) {
+                LineCode code = (LineCode)c;
+                string codeName = ::codeName(code);
+                for (size_t s = 0; s < singleShotCount && unpacked; s++) {
+                    if (singleShot[s].code == code) BENCH(singleShot[s].name, singleShot[s].encode(bits, symbols.data()));
+                }
+                if (unpacked) {
+                    // The per-bit policy loop, against the word-parallel kernels.
+                    BENCH("encode<" + codeName + ">", withScheme(code, [&](auto scheme) {
+                        encode<decltype(scheme)>(bits, symbols.data());
+                    }));
+                    BENCH("encodeParallel:" + codeName,
+                          encodeParallel(code, bits, symbols.data(), threads));
+                    encodeParallel(code, bits, symbols.data(), threads);
+                    BENCH("decodeSignal:" + codeName,
+                          decodeSignal(code, symbols.data(), n * symbolsPerBit(code), decoded));
+                }
+                BENCH("encodeSymbols:" + codeName, encodeSymbols(code, bits, packed));
+                BENCH("decodePacked:" + codeName, decodeSignal(code, packed, decoded));
+                // The spectrum costs the same for any pattern.
+                if (pattern == PATTERN_RANDOM) {
+                    SpectrumParams params;
+                    params.threads = threads;
+                    Spectrum spectrum;
+                    encodeSymbols(code, bits, packed);
+                    BENCH("welchPSD:" + codeName, welchPSD(packed, params, spectrum));
+                }
+            }
+
+            const int bitsPerSample = 8;
+            makeAnalog(pattern, unpacked ? n / bitsPerSample : 0, analog, rng);
+            if (!analog.empty()) {
+                BENCH("encodePCM", encodePCM(analog.data(), analog.size(), decoded, bitsPerSample));
+                BENCH("encodeCompanded:mulaw", encodeCompanded(COMPAND_MULAW, analog.data(), analog.size(), decoded));
+                restored.resize(analog.size());
+                BENCH("decodeCompanded:mulaw", decodeCompanded(COMPAND_MULAW, decoded, restored.data(), 1.0));
+                BENCH("encodeCompanded:alaw", encodeCompanded(COMPAND_ALAW, analog.data(), analog.size(), decoded));
+                // A T1-style chain with its analysis, fused and as a pass per stage.
+                BENCH("runPipeline:pcm+b8zs+analysis", {
+                    MemorySamples samples(analog.data(), analog.size());
+                    PCMModulator pcm(bitsPerSample, -1.0, 1.0);
+                    ModulatedBits source(samples, pcm);
+                    SignalStats stats;
+                    StatsSink statsSink(LINE_B8ZS, stats);
+                    PalindromeSink palindrome;
+                    vector<Sink*> sinks;
+                    sinks.push_back(&statsSink);
+                    sinks.push_back(&palindrome);
+                    runPipeline(source, LINE_B8ZS, NULL, sinks);
+                });
+                BENCH("passes:pcm+b8zs+analysis", {
+                    SignalStats stats;
+                    PCMEncoder pcm(bitsPerSample, -1.0, 1.0);
+                    decoded.clear();
+                    pcm.push(analog.data(), analog.size(), decoded);
+                    encodeSymbols(LINE_B8ZS, decoded, packed, &stats);
+                    findLongestPalindrome(decoded);
+                });
+                BENCH("PCMEncoder:fixed", {
+                    PCMEncoder pcm(bitsPerSample, -1.0, 1.0);
+                    decoded.clear();
+                    for (size_t i = 0; i < analog.size(); i += 4096) {
+                        pcm.push(analog.data() + i, min((size_t)4096, analog.size() - i), decoded);
+                    }
+                });
+            }
+            // Sources don't depend on the pattern; one run of each is enough.
+            if (pattern == PATTERN_RANDOM && unpacked) {
+                const Waveform waves[] = { WAVE_SINE, WAVE_CHIRP, WAVE_GAUSSIAN };
+                const char* waveNames[] = { "AnalogSource:sine", "AnalogSource:chirp", "AnalogSource:gaussian" };
+                analog.resize(n);
+                for (int w = 0; w < 3; w++) {
+                    SourceParams params;
+                    params.wave = waves[w];
+                    params.duration = n / params.sampleRate;
+                    BENCH(waveNames[w], AnalogSource(params).next(analog.data(), n));
+                }
+            }
+            makeAnalog(pattern, unpacked ? n : 0, analog, rng);
+            if (unpacked) {
+                BENCH("encodeDeltaMod", encodeDeltaMod(analog.data(), analog.size(), decoded));
+                BENCH("CVSDEncoder", {
+                    CVSDEncoder cvsd;
+                    decoded.clear();
+                    cvsd.push(analog.data(), analog.size(), decoded);
+                });
+                // The run table takes up to 5.5 bytes per bit.
+                BENCH("findLongestPalindrome", findLongestPalindrome(bits));
+                BENCH("PalindromeTracker:4096", {
+                    PalindromeTracker tracker;
+                    for (size_t w = 0; w < bits.words.size(); w += 64)
+                        tracker.push(BitView(bits.words.data() + w, min((size_t)4096, n - w * 64)));
+                    tracker.longest();
+                });
+            }
+            for (int c = 0; c < lineCodeCount; c++) {
+                SignalStats stats;
+                BENCH(string("encodeSymbols+stats:") + codeName((LineCode)c),
+                      encodeSymbols((LineCode)c, bits, packed, &stats));
+            }
+#undef BENCH
+        }
+        if (n > maxBits / 8) break;
+    }
+    return 0;
+}
@@ -0,0 +1,492 @@
+#ifndef SIGNAL_CODES_H
+#define SIGNAL_CODES_H
+
+// Line codes as policy types. Each scheme declares at compile time how many
+// symbols it sends per bit, its alphabet and the state it carries from bit to
+// bit, plus its per-bit encode and decode rules; encode<Scheme>,
+// decode<Scheme> and SchemeEncoder<Scheme> are generic over these, so each
+// instantiation is a straight loop with the scheme's rules inlined. A policy
+// also names the word-parallel kernels in signal_core.cpp that do the same
+// job faster, and signal_core.cpp dispatches every code through its policy,
+// so a new code is one policy, one LineCode and one case in withScheme();
+// the menus, flags, titles and the packed, streaming and parallel paths
+// pick it up from there. signal_test checks the kernels against these
+// rules symbol for symbol.
+//
+// A policy provides:
+//   code, symbolsPerBit, ternary (alphabet -1/0/+1 rather than -1/+1),
+//   bipolar (marks alternate, so two same-polarity pulses are a violation)
+//   and base (the code a scrambler rewrites; the code itself otherwise);
+//   name() for --scheme/--scramble, title() for plots and menus;
+//   State and encodeBit(State&, bit, out), returning the symbols written,
+//   with finish(State&, out) writing any that were held back;
+//   Reader and decodeBit(Reader&, symbols, i, n) for the bit whose first
+//   symbol is symbols[i], counting violations in Reader::violations;
+//   Encoder, the StreamEncoder to use, and encoderAt(start, heldBack), one
+//   that picks up a stream at a chunk boundary;
+//   planeKernel and decodeKernel, the kernels that write its packed planes
+//   and decode it (KERNEL_NONE for the per-bit rules), and differential,
+//   true when those kernels run on the running parity of the bits.
+
+#include <cstddef>
+#include "signal_core.h"
+
+// KERNELS :-
+
+enum CodeKernel {
+    KERNEL_NONE,
+    KERNEL_LEVELS,      // a symbol per bit, high for a 1
+    KERNEL_PAIRS,       // Manchester pairs, low then high for a 1
+    KERNEL_BIPOLAR      // AMI pulses, and the B8ZS/HDB3 substitutions when decoding
+};
+
+// The state of an encoder at a chunk boundary, as encodeParallel() works it
+// out from the bits before the chunk.
+struct StreamStart {
+    uint64_t ones;          // ones before the chunk
+    size_t zeroRun;         // zeros since the last one
+    bool hdb3Even;          // HDB3: even number of pulses since the last substitution
+    bool hdb3High;          // HDB3: last pulse was positive
+
+    uint64_t parity() const { return (ones & 1) ? ~0ULL : 0; }
+};
+
+template <class Scheme> class SchemeEncoder;
+
+// POLICIES :-
+
+struct NRZLCode {
+    static const LineCode code = LINE_NRZL, base = LINE_NRZL;
+    static const int symbolsPerBit = 1;
+    static const bool ternary = false, bipolar = false;
+    static const char* name() { return "nrzl"; }
+    static const char* title() { return "NRZ-L Encoding"; }
+
+    typedef NRZLEncoder Encoder;
+    static const CodeKernel planeKernel = KERNEL_LEVELS, decodeKernel = KERNEL_LEVELS;
+    static const bool differential = false;
+    static StreamEncoder* encoderAt(const StreamStart&, size_t& heldBack) {
+        heldBack = 0;
+        return new NRZLEncoder();
+    }
+
+    struct State {};
+    static size_t encodeBit(State&, int bit, int* out) {
+        out[0] = bit ? 1 : -1;
+        return 1;
+    }
+    static size_t finish(State&, int*) { return 0; }
+
+    struct Reader { size_t violations = 0; };
+    template <class Symbols>
+    static int decodeBit(Reader& r, const Symbols& s, size_t i, size_t) {
+        r.violations += s[i] == 0;
+        return s[i] > 0;
+    }
+};
+
+// A 1 toggles the level, which starts low.
+struct NRZICode {
+    static const LineCode code = LINE_NRZI, base = LINE_NRZI;
+    static const int symbolsPerBit = 1;
+    static const bool ternary = false, bipolar = false;
+    static const char* name() { return "nrzi"; }
+    static const char* title() { return "NRZ-I Encoding"; }
+
+    typedef NRZIEncoder Encoder;
+    static const CodeKernel planeKernel = KERNEL_LEVELS, decodeKernel = KERNEL_LEVELS;
+    static const bool differential = true;
+    static StreamEncoder* encoderAt(const StreamStart& at, size_t& heldBack) {
+        heldBack = 0;
+        return new NRZIEncoder(at.parity());
+    }
+
+    struct State { int level = -1; };
+    static size_t encodeBit(State& st, int bit, int* out) {
+        if (bit) st.level = -st.level;
+        out[0] = st.level;
+        return 1;
+    }
+    static size_t finish(State&, int*) { return 0; }
+
+    struct Reader { bool high = false; size_t violations = 0; };
+    template <class Symbols>
+    static int decodeBit(Reader& r, const Symbols& s, size_t i, size_t) {
+        bool high = s[i] > 0;
+        r.violations += s[i] == 0;
+        int bit = high != r.high;
+        r.high = high;
+        return bit;
+    }
+};
+
+// 0 is high then low, 1 low then high.
+struct ManchesterCode {
+    static const LineCode code = LINE_MANCHESTER, base = LINE_MANCHESTER;
+    static const int symbolsPerBit = 2;
+    static const bool ternary = false, bipolar = false;
+    static const char* name() { return "manchester"; }
+    static const char* title() { return "Manchester Encoding"; }
+
+    typedef ManchesterEncoder Encoder;
+    static const CodeKernel planeKernel = KERNEL_PAIRS, decodeKernel = KERNEL_PAIRS;
+    static const bool differential = false;
+    static StreamEncoder* encoderAt(const StreamStart&, size_t& heldBack) {
+        heldBack = 0;
+        return new ManchesterEncoder();
+    }
+
+    struct State {};
+    static size_t encodeBit(State&, int bit, int* out) {
+        out[0] = bit ? -1 : 1;
+        out[1] = -out[0];
+        return 2;
+    }
+    static size_t finish(State&, int*) { return 0; }
+
+    struct Reader { size_t violations = 0; };
+    template <class Symbols>
+    static int decodeBit(Reader& r, const Symbols& s, size_t i, size_t) {
+        int a = s[i], b = s[i + 1];
+        r.violations += !((a > 0 && b < 0) || (a < 0 && b > 0));
+        return a < 0;
+    }
+};
+
+// A 1 inverts the pair, which starts as high then low.
+struct DiffManchesterCode {
+    static const LineCode code = LINE_DIFF_MANCHESTER, base = LINE_DIFF_MANCHESTER;
+    static const int symbolsPerBit = 2;
+    static const bool ternary = false, bipolar = false;
+    static const char* name() { return "diff-manchester"; }
+    static const char* title() { return "Differential Manchester"; }
+
+    typedef DiffManchesterEncoder Encoder;
+    static const CodeKernel planeKernel = KERNEL_PAIRS, decodeKernel = KERNEL_PAIRS;
+    static const bool differential = true;
+    static StreamEncoder* encoderAt(const StreamStart& at, size_t& heldBack) {
+        heldBack = 0;
+        return new DiffManchesterEncoder(at.parity());
+    }
+
+    struct State { int first = 1; };
+    static size_t encodeBit(State& st, int bit, int* out) {
+        if (bit) st.first = -st.first;
+        out[0] = st.first;
+        out[1] = -st.first;
+        return 2;
+    }
+    static size_t finish(State&, int*) { return 0; }
+
+    struct Reader { bool high = true; size_t violations = 0; };
+    template <class Symbols>
+    static int decodeBit(Reader& r, const Symbols& s, size_t i, size_t) {
+        int a = s[i], b = s[i + 1];
+        r.violations += !((a > 0 && b < 0) || (a < 0 && b > 0));
+        bool high = a > 0;
+        int bit = high != r.high;
+        r.high = high;
+        return bit;
+    }
+};
+
+// Marks alternate in polarity, the first positive; spaces are 0.
+struct AMICode {
+    static const LineCode code = LINE_AMI, base = LINE_AMI;
+    static const int symbolsPerBit = 1;
+    static const bool ternary = true, bipolar = true;
+    static const char* name() { return "ami"; }
+    static const char* title() { return "AMI Encoding"; }
+
+    typedef AMIEncoder Encoder;
+    static const CodeKernel planeKernel = KERNEL_BIPOLAR, decodeKernel = KERNEL_BIPOLAR;
+    static const bool differential = true;
+    static StreamEncoder* encoderAt(const StreamStart& at, size_t& heldBack) {
+        heldBack = 0;
+        return new AMIEncoder((at.ones & 1) ? -1 : 1);
+    }
+
+    struct State { int next = 1; };
+    static size_t encodeBit(State& st, int bit, int* out) {
+        out[0] = bit ? st.next : 0;
+        if (bit) st.next = -st.next;
+        return 1;
+    }
+    static size_t finish(State&, int*) { return 0; }
+
+    struct Reader { int last = -1; size_t violations = 0; };
+    template <class Symbols>
+    static int decodeBit(Reader& r, const Symbols& s, size_t i, size_t) {
+        if (s[i] == 0) return 0;
+        int pol = s[i] > 0 ? 1 : -1;
+        r.violations += pol == r.last;
+        r.last = pol;
+        return 1;
+    }
+};
+
+// AMI with eight zeros sent as 000VB0VB, V repeating the last pulse. Zeros
+// are held back until the run either ends or reaches eight.
+struct B8ZSCode {
+    static const LineCode code = LINE_B8ZS, base = LINE_AMI;
+    static const int symbolsPerBit = 1;
+    static const bool ternary = true, bipolar = true;
+    static const char* name() { return "b8zs"; }
+    static const char* title() { return "AMI with B8ZS"; }
+
+    typedef B8ZSEncoder Encoder;
+    static const CodeKernel planeKernel = KERNEL_NONE, decodeKernel = KERNEL_BIPOLAR;
+    static const bool differential = false;
+    static StreamEncoder* encoderAt(const StreamStart& at, size_t& heldBack) {
+        // The zeros since the last substitution are written by this chunk.
+        heldBack = at.zeroRun % 8;
+        return new B8ZSEncoder((int)heldBack, (at.ones & 1) == 0);
+    }
+
+    struct State { int next = 1, zeros = 0; };
+    static size_t encodeBit(State& st, int bit, int* out) {
+        if (!bit) {
+            if (++st.zeros < 8) return 0;
+            int v = -st.next;
+            const int pattern[8] = { 0, 0, 0, v, -v, 0, -v, v };
+            for (int j = 0; j < 8; j++) out[j] = pattern[j];
+            st.zeros = 0;
+            return 8;
+        }
+        size_t k = finish(st, out);
+        out[k] = st.next;
+        st.next = -st.next;
+        return k + 1;
+    }
+    static size_t finish(State& st, int* out) {
+        size_t k = st.zeros;
+        for (size_t j = 0; j < k; j++) out[j] = 0;
+        st.zeros = 0;
+        return k;
+    }
+
+    struct Reader { int last = -1, zeros = 0; size_t violations = 0; };
+    template <class Symbols>
+    static int decodeBit(Reader& r, const Symbols& s, size_t i, size_t n) {
+        if (r.zeros > 0) {
+            r.zeros--;
+            return 0;
+        }
+        if (s[i] == 0) return 0;
+        int pol = s[i] > 0 ? 1 : -1;
+        if (pol == r.last) {
+            int last = r.last;
+            if (i >= 3 && i + 4 < n && s[i-3] == 0 && s[i-2] == 0 && s[i-1] == 0 &&
+                s[i+1] == -last && s[i+2] == 0 && s[i+3] == -last && s[i+4] == last) {
+                r.zeros = 4;
+                return 0;
+            }
+            r.violations++;
+        }
+        r.last = pol;
+        return 1;
+    }
+};
+
+// AMI with four zeros sent as B00V after an even number of pulses since the
+// last substitution and 000V after an odd number; V repeats the pulse
+// before it.
+struct HDB3Code {
+    static const LineCode code = LINE_HDB3, base = LINE_AMI;
+    static const int symbolsPerBit = 1;
+    static const bool ternary = true, bipolar = true;
+    static const char* name() { return "hdb3"; }
+    static const char* title() { return "AMI with HDB3"; }
+
+    typedef HDB3Encoder Encoder;
+    static const CodeKernel planeKernel = KERNEL_NONE, decodeKernel = KERNEL_BIPOLAR;
+    static const bool differential = false;
+    static StreamEncoder* encoderAt(const StreamStart& at, size_t& heldBack) {
+        heldBack = at.zeroRun % 4;
+        return new HDB3Encoder((int)heldBack, at.hdb3Even, at.hdb3High);
+    }
+
+    struct State { int next = 1, zeros = 0; bool even = true; };
+    static size_t encodeBit(State& st, int bit, int* out) {
+        if (!bit) {
+            if (++st.zeros < 4) return 0;
+            int v = st.even ? st.next : -st.next;
+            out[0] = st.even ? v : 0;
+            out[1] = 0;
+            out[2] = 0;
+            out[3] = v;
+            st.next = -v;
+            st.even = true;
+            st.zeros = 0;
+            return 4;
+        }
+        size_t k = finish(st, out);
+        out[k] = st.next;
+        st.next = -st.next;
+        st.even = !st.even;
+        return k + 1;
+    }
+    static size_t finish(State& st, int* out) {
+        size_t k = st.zeros;
+        for (size_t j = 0; j < k; j++) out[j] = 0;
+        st.zeros = 0;
+        return k;
+    }
+
+    // A B is recognised by the V three symbols on; a V by the two zeros
+    // before it.
+    struct Reader { int last = -1; size_t violations = 0; };
+    template <class Symbols>
+    static int decodeBit(Reader& r, const Symbols& s, size_t i, size_t n) {
+        if (s[i] == 0) return 0;
+        int pol = s[i] > 0 ? 1 : -1, last = r.last;
+        r.last = pol;
+        if (pol == last) {
+            if (i >= 3 && s[i-1] == 0 && s[i-2] == 0) return 0;
+            r.violations++;
+        }
+        return !(i + 3 < n && s[i+1] == 0 && s[i+2] == 0 && s[i+3] == pol);
+    }
+};
+
+// MLT-3: each 1 steps the level through 0, +1, 0, -1; a 0 holds it.
+struct MLT3Code {
+    static const LineCode code = LINE_MLT3, base = LINE_MLT3;
+    static const int symbolsPerBit = 1;
+    static const bool ternary = true, bipolar = false;
+    static const char* name() { return "mlt3"; }
+    static const char* title() { return "MLT-3 Encoding"; }
+
+    typedef SchemeEncoder<MLT3Code> Encoder;
+    static const CodeKernel planeKernel = KERNEL_NONE, decodeKernel = KERNEL_NONE;
+    static const bool differential = false;
+    static StreamEncoder* encoderAt(const StreamStart& at, size_t& heldBack);
+
+    static int level(int phase) { return (phase & 1) ? 2 - phase : 0; }
+
+    struct State { int phase = 0; };
+    static size_t encodeBit(State& st, int bit, int* out) {
+        st.phase = (st.phase + bit) & 3;
+        out[0] = level(st.phase);
+        return 1;
+    }
+    static size_t finish(State&, int*) { return 0; }
+
+    // A level that is neither held nor the next step, such as +1 straight
+    // to -1, is a violation; decoding picks up again from that level.
+    struct Reader { int phase = 0; size_t violations = 0; };
+    template <class Symbols>
+    static int decodeBit(Reader& r, const Symbols& s, size_t i, size_t) {
+        int x = s[i];
+        if (x == level(r.phase)) return 0;
+        r.phase = (r.phase + 1) & 3;
+        if (x != level(r.phase)) {
+            r.violations++;
+            r.phase = x > 0 ? 1 : 3;
+        }
+        return 1;
+    }
+};
+
+// Calls fn with a value of the policy type for code, so generic code can
+// be written once and instantiated per scheme.
+template <class Fn>
+inline auto withScheme(LineCode code, Fn fn) -> decltype(fn(NRZLCode())) {
+    switch (code) {
+        case LINE_NRZL: return fn(NRZLCode());
+        case LINE_NRZI: return fn(NRZICode());
+        case LINE_MANCHESTER: return fn(ManchesterCode());
+        case LINE_DIFF_MANCHESTER: return fn(DiffManchesterCode());
+        case LINE_AMI: return fn(AMICode());
+        case LINE_B8ZS: return fn(B8ZSCode());
+        case LINE_HDB3: return fn(HDB3Code());
+        case LINE_MLT3: return fn(MLT3Code());
+    }
+    return fn(NRZLCode());
+}
+
+// GENERIC CODING :-
+
+// The symbols for bits, from the scheme's start state; returns how many
+// were written, bits.size() * symbolsPerBit for every scheme.
+template <class Scheme>
+size_t encode(BitView bits, int* out) {
+    typename Scheme::State st;
+    size_t k = 0, n = bits.size();
+    for (size_t base = 0; base < n; base += 64) {
+        uint64_t word = bits.words[base >> 6];
+        size_t end = n - base < 64 ? n : base + 64;
+        for (size_t i = base; i < end; i++, word >>= 1) k += Scheme::encodeBit(st, (int)(word & 1), out + k);
+    }
+    return k + Scheme::finish(st, out + k);
+}
+
+// Bits back from n symbols read through s[i] (an int array or anything
+// indexable like one); returns the code violations, counting a trailing
+// partial symbol group as one.
+template <class Scheme, class Symbols>
+size_t decode(const Symbols& s, size_t n, BitStream& bits) {
+    typename Scheme::Reader r;
+    size_t per = Scheme::symbolsPerBit, count = n / per;
+    bits.clear();
+    bits.resize(count);
+    for (size_t b = 0; b < count; b++) {
+        if (Scheme::decodeBit(r, s, b * per, n)) bits.words[b >> 6] |= 1ULL << (b & 63);
+    }
+    return r.violations + (n % per != 0);
+}
+
+template <class Scheme>
+class SchemeEncoder : public StreamEncoder {
+    typename Scheme::State st;
+public:
+    SchemeEncoder(const typename Scheme::State& start = typename Scheme::State()) : st(start) {}
+    int symbolsPerBit() const { return Scheme::symbolsPerBit; }
+
+    size_t push(BitView chunk, int* out) {
+        size_t k = 0, n = chunk.size();
+        for (size_t i = 0; i < n; i++) k += Scheme::encodeBit(st, chunk.get(i), out + k);
+        return k;
+    }
+
+    size_t finish(int* out) { return Scheme::finish(st, out); }
+};
+
+// Each 1 is one step of the level's four-step cycle.
+inline StreamEncoder* MLT3Code::encoderAt(const StreamStart& at, size_t& heldBack) {
+    MLT3Code::State st;
+    st.phase = (int)(at.ones & 3);
+    heldBack = 0;
+    return new SchemeEncoder<MLT3Code>(st);
+}
+
+// TRAITS :-
+
+inline const char* codeName(LineCode code) {
+    return withScheme(code, [](auto scheme) { return decltype(scheme)::name(); });
+}
+
+inline const char* codeTitle(LineCode code) {
+    return withScheme(code, [](auto scheme) { return decltype(scheme)::title(); });
+}
+
+// The kernels a code's policy names, for picking a path at run time.
+struct CodeKernels {
+    CodeKernel planes, decoder;
+    bool differential;
+};
+
+inline CodeKernels codeKernels(LineCode code) {
+    return withScheme(code, [](auto scheme) {
+        typedef decltype(scheme) Scheme;
+        CodeKernels k = { Scheme::planeKernel, Scheme::decodeKernel, Scheme::differential };
+        return k;
+    });
+}
+
+// The code a scrambler rewrites, or the code itself.
+inline LineCode baseCode(LineCode code) {
+    return withScheme(code, [](auto scheme) { return decltype(scheme)::base; });
+}
+
+#endif
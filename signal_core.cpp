@@ -0,0 +1,2005 @@
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <cctype>
+#include "signal_core.h"
+#include "signal_codes.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIGNAL_X86 1
+#endif
+using namespace std;
+
+// BIT STREAM :-
+
+size_t parseBits(const string& text, BitStream& bits) {
+    bits.clear();
+    bits.resize(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '1') bits.words[i >> 6] |= 1ULL << (i & 63);
+    }
+    return bits.size();
+}
+
+void printBits(BitView bits) {
+    string text(bits.size(), '0');
+    for (size_t i = 0; i < bits.size(); i++) {
+        if (bits.get(i)) text[i] = '1';
+    }
+    cout << text;
+}
+
+// SYMBOL KERNELS :-
+
+// Expand packed bits into int symbols. "Levels" maps 1 -> +1, 0 -> -1;
+// "Manchester" maps 0 -> (+1, -1), 1 -> (-1, +1). Whole words go through the
+// widest kernel the CPU supports, the tail bits through the scalar loop.
+
+typedef void (*ExpandKernel)(const uint64_t* words, size_t n, int* out);
+
+static void expandLevelsScalar(const uint64_t* words, size_t n, int* out) {
+    for (size_t base = 0; base < n; base += 64) {
+        uint64_t word = words[base >> 6];
+        size_t end = min(n, base + 64);
+        for (size_t i = base; i < end; i++, word >>= 1) {
+            out[i] = (word & 1) ? 1 : -1;
+        }
+    }
+}
+
+static void expandManchesterScalar(const uint64_t* words, size_t n, int* out) {
+    for (size_t base = 0; base < n; base += 64) {
+        uint64_t word = words[base >> 6];
+        size_t end = min(n, base + 64);
+        for (size_t i = base; i < end; i++, word >>= 1) {
+            int level = (word & 1) ? 1 : -1;
+            out[2*i] = -level;
+            out[2*i + 1] = level;
+        }
+    }
+}
+
+#ifdef SIGNAL_X86
+
+// Each lane tests one bit of a broadcast byte: (cmpeq(v & sel, sel) ^ flip) & 2
+// is 2 for a high symbol and 0 for a low one, and subtracting 1 gives +1/-1.
+// flip inverts the first half of each Manchester pair.
+
+__attribute__((target("sse2")))
+static void expandLevelsSSE2(const uint64_t* words, size_t n, int* out) {
+    const __m128i selLo = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128i selHi = _mm_setr_epi32(16, 32, 64, 128);
+    const __m128i two = _mm_set1_epi32(2), one = _mm_set1_epi32(1);
+    size_t full = n / 64;
+    for (size_t w = 0; w < full; w++) {
+        uint64_t word = words[w];
+        int* dst = out + w * 64;
+        for (int b = 0; b < 8; b++, word >>= 8, dst += 8) {
+            __m128i v = _mm_set1_epi32((int)(word & 0xFF));
+            __m128i lo = _mm_cmpeq_epi32(_mm_and_si128(v, selLo), selLo);
+            __m128i hi = _mm_cmpeq_epi32(_mm_and_si128(v, selHi), selHi);
+            _mm_storeu_si128((__m128i*)dst, _mm_sub_epi32(_mm_and_si128(lo, two), one));
+            _mm_storeu_si128((__m128i*)(dst + 4), _mm_sub_epi32(_mm_and_si128(hi, two), one));
+        }
+    }
+    expandLevelsScalar(words + full, n - full * 64, out + full * 64);
+}
+
+__attribute__((target("avx2")))
+static void expandLevelsAVX2(const uint64_t* words, size_t n, int* out) {
+    const __m256i sel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i two = _mm256_set1_epi32(2), one = _mm256_set1_epi32(1);
+    size_t full = n / 64;
+    for (size_t w = 0; w < full; w++) {
+        uint64_t word = words[w];
+        int* dst = out + w * 64;
+        for (int b = 0; b < 8; b++, word >>= 8, dst += 8) {
+            __m256i v = _mm256_set1_epi32((int)(word & 0xFF));
+            __m256i m = _mm256_cmpeq_epi32(_mm256_and_si256(v, sel), sel);
+            _mm256_storeu_si256((__m256i*)dst, _mm256_sub_epi32(_mm256_and_si256(m, two), one));
+        }
+    }
+    expandLevelsScalar(words + full, n - full * 64, out + full * 64);
+}
+
+__attribute__((target("sse2")))
+static void expandManchesterSSE2(const uint64_t* words, size_t n, int* out) {
+    __m128i sel[4];
+    for (int k = 0; k < 4; k++) sel[k] = _mm_setr_epi32(1 << (2*k), 1 << (2*k), 2 << (2*k), 2 << (2*k));
+    const __m128i flip = _mm_setr_epi32(-1, 0, -1, 0);
+    const __m128i two = _mm_set1_epi32(2), one = _mm_set1_epi32(1);
+    size_t full = n / 64;
+    for (size_t w = 0; w < full; w++) {
+        uint64_t word = words[w];
+        int* dst = out + w * 128;
+        for (int b = 0; b < 8; b++, word >>= 8) {
+            __m128i v = _mm_set1_epi32((int)(word & 0xFF));
+            for (int k = 0; k < 4; k++, dst += 4) {
+                __m128i m = _mm_cmpeq_epi32(_mm_and_si128(v, sel[k]), sel[k]);
+                m = _mm_xor_si128(m, flip);
+                _mm_storeu_si128((__m128i*)dst, _mm_sub_epi32(_mm_and_si128(m, two), one));
+            }
+        }
+    }
+    expandManchesterScalar(words + full, n - full * 64, out + full * 128);
+}
+
+__attribute__((target("avx2")))
+static void expandManchesterAVX2(const uint64_t* words, size_t n, int* out) {
+    const __m256i selLo = _mm256_setr_epi32(1, 1, 2, 2, 4, 4, 8, 8);
+    const __m256i selHi = _mm256_setr_epi32(16, 16, 32, 32, 64, 64, 128, 128);
+    const __m256i flip = _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+    const __m256i two = _mm256_set1_epi32(2), one = _mm256_set1_epi32(1);
+    size_t full = n / 64;
+    for (size_t w = 0; w < full; w++) {
+        uint64_t word = words[w];
+        int* dst = out + w * 128;
+        for (int b = 0; b < 8; b++, word >>= 8, dst += 16) {
+            __m256i v = _mm256_set1_epi32((int)(word & 0xFF));
+            __m256i lo = _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(v, selLo), selLo), flip);
+            __m256i hi = _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(v, selHi), selHi), flip);
+            _mm256_storeu_si256((__m256i*)dst, _mm256_sub_epi32(_mm256_and_si256(lo, two), one));
+            _mm256_storeu_si256((__m256i*)(dst + 8), _mm256_sub_epi32(_mm256_and_si256(hi, two), one));
+        }
+    }
+    expandManchesterScalar(words + full, n - full * 64, out + full * 128);
+}
+
+#endif
+
+SimdLevel cpuSimdLevel() {
+#ifdef SIGNAL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+static SimdLevel simdLevel = cpuSimdLevel();
+
+SimdLevel currentSimdLevel() {
+    return simdLevel;
+}
+
+#ifdef SIGNAL_X86
+static ExpandKernel expandLevels =
+    pickKernel(expandLevelsAVX2, expandLevelsSSE2, expandLevelsScalar);
+static ExpandKernel expandManchester =
+    pickKernel(expandManchesterAVX2, expandManchesterSSE2, expandManchesterScalar);
+#else
+static const ExpandKernel expandLevels = expandLevelsScalar;
+static const ExpandKernel expandManchester = expandManchesterScalar;
+#endif
+
+// Running parity: bit i of the result is the XOR of input bits 0..i. NRZ-I and
+// Differential Manchester are NRZ-L and Manchester applied to this parity, so
+// both reduce to one prefix-XOR per word followed by the kernels above.
+// carry is all ones when the parity of everything before the block is odd.
+
+typedef uint64_t (*ParityKernel)(const uint64_t* in, uint64_t* out, size_t count, uint64_t carry);
+
+static uint64_t prefixParityShift(const uint64_t* in, uint64_t* out, size_t count, uint64_t carry) {
+    for (size_t w = 0; w < count; w++) {
+        uint64_t x = in[w];
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        x ^= carry;
+        out[w] = x;
+        carry = 0 - (x >> 63);
+    }
+    return carry;
+}
+
+#ifdef SIGNAL_X86
+
+// A carry-less multiply by all ones is the prefix XOR of the low word.
+__attribute__((target("pclmul,sse2")))
+static uint64_t prefixParityClmul(const uint64_t* in, uint64_t* out, size_t count, uint64_t carry) {
+    const __m128i ones = _mm_set1_epi32(-1);
+    for (size_t w = 0; w < count; w++) {
+        __m128i x = _mm_loadl_epi64((const __m128i*)(in + w));
+        __m128i p = _mm_clmulepi64_si128(x, ones, 0x00);
+        uint64_t y;
+        _mm_storel_epi64((__m128i*)&y, p);
+        y ^= carry;
+        out[w] = y;
+        carry = 0 - (y >> 63);
+    }
+    return carry;
+}
+
+static ParityKernel pickParityKernel() {
+    if (simdLevel > SIMD_SCALAR && __builtin_cpu_supports("pclmul")) return prefixParityClmul;
+    return prefixParityShift;
+}
+
+static ParityKernel prefixParity = pickParityKernel();
+#else
+static const ParityKernel prefixParity = prefixParityShift;
+#endif
+
+// Expands the running parity of n packed bits through `expand`, a block of
+// words at a time so the parity stays in L1. Returns the outgoing carry.
+static uint64_t expandParity(const uint64_t* words, size_t n, int* out,
+                             ExpandKernel expand, int symbolsPerBit, uint64_t carry) {
+    const size_t blockWords = 64;
+    uint64_t parity[blockWords];
+    for (size_t base = 0; base < n; base += blockWords * 64) {
+        size_t count = min(blockWords, (n - base + 63) / 64);
+        carry = prefixParity(words + base / 64, parity, count, carry);
+        expand(parity, min(n - base, count * 64), out + base * symbolsPerBit);
+    }
+    return carry;
+}
+
+// LINE CODING :-
+
+void encodeNRZL(BitView bits, int* encoded) {
+    if (bits.size()) expandLevels(bits.words, bits.size(), encoded);
+}
+
+void encodeNRZI(BitView bits, int* encoded) {
+    expandParity(bits.words, bits.size(), encoded, expandLevels, 1, 0);
+}
+
+void encodeManchester(BitView bits, int* encoded) {
+    if (bits.size()) expandManchester(bits.words, bits.size(), encoded);
+}
+
+void encodeDiffManchester(BitView bits, int* encoded) {
+    expandParity(bits.words, bits.size(), encoded, expandManchester, 2, 0);
+}
+
+// AMI pulses alternate starting from lastPolarity; returns the next polarity.
+static int encodeAMIWords(const uint64_t* words, size_t n, int* out, int lastPolarity) {
+    for (size_t base = 0; base < n; base += 64) {
+        uint64_t word = words[base >> 6];
+        size_t end = min(n, base + 64);
+        for (size_t i = base; i < end; i++, word >>= 1) {
+            if (!(word & 1)) out[i] = 0;
+            else {
+                out[i] = lastPolarity;
+                lastPolarity = -lastPolarity;
+            }
+        }
+    }
+    return lastPolarity;
+}
+
+void encodeAMI(BitView bits, int* encoded) {
+    encodeAMIWords(bits.words, bits.size(), encoded, 1);
+}
+
+//STREAMING:-
+
+size_t NRZLEncoder::push(BitView chunk, int* out) {
+    encodeNRZL(chunk, out);
+    return chunk.size();
+}
+
+size_t NRZIEncoder::push(BitView chunk, int* out) {
+    carry = expandParity(chunk.words, chunk.size(), out, expandLevels, 1, carry);
+    return chunk.size();
+}
+
+size_t ManchesterEncoder::push(BitView chunk, int* out) {
+    encodeManchester(chunk, out);
+    return chunk.size() * 2;
+}
+
+size_t DiffManchesterEncoder::push(BitView chunk, int* out) {
+    carry = expandParity(chunk.words, chunk.size(), out, expandManchester, 2, carry);
+    return chunk.size() * 2;
+}
+
+size_t AMIEncoder::push(BitView chunk, int* out) {
+    lastPolarity = encodeAMIWords(chunk.words, chunk.size(), out, lastPolarity);
+    return chunk.size();
+}
+
+// Both scramblers walk the input a run at a time: BitView::next() finds the
+// end of each run of zeros or ones with a count-trailing-zeros per word, so
+// idle stretches cost one step per 64 bits. A zero run only needs its length
+// to place its substitutions, and a run of ones is a plain alternation.
+
+static size_t writeAlternating(int* out, size_t count, int first) {
+    for (size_t j = 0; j < count; j++, first = -first) out[j] = first;
+    return count;
+}
+
+size_t B8ZSEncoder::push(BitView chunk, int* out) {
+    size_t k = 0, i = 0, n = chunk.size();
+    while (i < n) {
+        size_t one = chunk.next(i, 1);
+        size_t zeros = zeroCount + (one - i);
+        if (zeros >= 8) {
+            int v = flag ? -1 : 1;
+            const int pattern[8] = { 0, 0, 0, v, -v, 0, -v, v };
+            for (size_t s = zeros / 8; s > 0; s--, k += 8) memcpy(out + k, pattern, sizeof(pattern));
+        }
+        zeroCount = (int)(zeros % 8);
+        if (one == n) break;
+
+        memset(out + k, 0, zeroCount * sizeof(int));
+        k += zeroCount;
+        zeroCount = 0;
+        i = chunk.next(one, 0);
+        k += writeAlternating(out + k, i - one, flag ? 1 : -1);
+        if ((i - one) & 1) flag = !flag;
+    }
+    return k;
+}
+
+size_t B8ZSEncoder::finish(int* out) {
+    size_t k = zeroCount;
+    memset(out, 0, k * sizeof(int));
+    zeroCount = 0;
+    return k;
+}
+
+size_t HDB3Encoder::push(BitView chunk, int* out) {
+    size_t k = 0, i = 0, n = chunk.size();
+    while (i < n) {
+        size_t one = chunk.next(i, 1);
+        size_t zeros = zeroCount + (one - i);
+        for (size_t s = zeros / 4; s > 0; s--) {
+            int v;
+            if (flag) {
+                v = prev ? -1 : 1;
+                out[k++] = v;
+            } else {
+                v = prev ? 1 : -1;
+                out[k++] = 0;
+            }
+            out[k++] = 0;
+            out[k++] = 0;
+            out[k++] = v;
+            flag = true;
+            prev = (v > 0);
+        }
+        zeroCount = (int)(zeros % 4);
+        if (one == n) break;
+
+        memset(out + k, 0, zeroCount * sizeof(int));
+        k += zeroCount;
+        zeroCount = 0;
+        i = chunk.next(one, 0);
+        k += writeAlternating(out + k, i - one, prev ? -1 : 1);
+        if ((i - one) & 1) {
+            flag = !flag;
+            prev = !prev;
+        }
+    }
+    return k;
+}
+
+size_t HDB3Encoder::finish(int* out) {
+    size_t k = zeroCount;
+    memset(out, 0, k * sizeof(int));
+    zeroCount = 0;
+    return k;
+}
+
+int symbolsPerBit(LineCode code) {
+    return withScheme(code, [](auto scheme) { return decltype(scheme)::symbolsPerBit; });
+}
+
+bool isTernary(LineCode code) {
+    return withScheme(code, [](auto scheme) { return decltype(scheme)::ternary; });
+}
+
+bool isBipolar(LineCode code) {
+    return withScheme(code, [](auto scheme) { return decltype(scheme)::bipolar; });
+}
+
+StreamEncoder* makeEncoder(LineCode code) {
+    return withScheme(code, [](auto scheme) -> StreamEncoder* {
+        return new typename decltype(scheme)::Encoder();
+    });
+}
+
+size_t encodeStream(istream& in, ostream& out, StreamEncoder& encoder) {
+    const size_t chunkBits = 1 << 16;
+    vector<char> text(chunkBits);
+    vector<int> symbols(encoder.maxOutput(chunkBits));
+    BitStream chunk;
+    size_t total = 0, k;
+
+    while (in.read(text.data(), chunkBits) || in.gcount() > 0) {
+        size_t got = (size_t)in.gcount();
+        chunk.clear();
+        for (size_t i = 0; i < got; i++) {
+            if (!isspace((unsigned char)text[i])) chunk.push(text[i] == '1');
+        }
+        k = encoder.push(chunk, symbols.data());
+        for (size_t i = 0; i < k; i++) out << symbols[i] << " ";
+        total += k;
+    }
+    k = encoder.finish(symbols.data());
+    for (size_t i = 0; i < k; i++) out << symbols[i] << " ";
+    return total + k;
+}
+
+//SCRAMBLING:-
+
+// --- B8ZS Scrambling ---
+void scrambleB8ZS(BitView bits, int* encoded) {
+    B8ZSEncoder encoder;
+    size_t k = encoder.push(bits, encoded);
+    encoder.finish(encoded + k);
+}
+
+// --- HDB3 Scrambling ---
+void scrambleHDB3(BitView bits, int* encoded) {
+    HDB3Encoder encoder;
+    size_t k = encoder.push(bits, encoded);
+    encoder.finish(encoded + k);
+}
+
+
+
+
+//PARALLEL:-
+
+// Large inputs are cut into one word-aligned chunk per thread. A first
+// parallel pass summarises each chunk, a serial pass over the summaries
+// works out the state every chunk starts in, and a second parallel pass
+// encodes each chunk from that state with the encoder its policy's
+// encoderAt() gives. A B8ZS/HDB3 zero run that straddles a boundary is
+// written by the chunk it ends in: that chunk's encoder starts with the
+// run's zeros pending and its output begins that many symbols early.
+
+struct ChunkSummary {
+    size_t ones;
+    size_t leadingZeros;    // the chunk length when it has no ones
+    size_t trailingZeros;
+    // HDB3 from the first one to the end, indexed by the flag at that one:
+    // the flag afterwards and whether the pulse polarity flipped overall.
+    bool hdb3Flag[2];
+    bool hdb3Toggle[2];
+};
+
+static void summarizeChunk(BitView chunk, bool hdb3, ChunkSummary& sum) {
+    size_t n = chunk.size(), nWords = (n + 63) / 64;
+    sum.ones = 0;
+    for (size_t w = 0; w < nWords; w++) sum.ones += __builtin_popcountll(chunk.words[w]);
+
+    sum.leadingZeros = n;
+    sum.trailingZeros = n;
+    if (sum.ones) {
+        size_t w = 0;
+        while (!chunk.words[w]) w++;
+        sum.leadingZeros = w * 64 + __builtin_ctzll(chunk.words[w]);
+        w = nWords - 1;
+        while (!chunk.words[w]) w--;
+        sum.trailingZeros = n - 1 - (w * 64 + 63 - __builtin_clzll(chunk.words[w]));
+    }
+
+    sum.hdb3Flag[0] = false;
+    sum.hdb3Flag[1] = true;
+    sum.hdb3Toggle[0] = sum.hdb3Toggle[1] = false;
+    if (!hdb3 || !sum.ones) return;
+
+    size_t i = sum.leadingZeros;
+    while (i < n) {
+        size_t zero = chunk.next(i, 0);
+        if ((zero - i) & 1) {
+            for (int f = 0; f < 2; f++) {
+                sum.hdb3Flag[f] = !sum.hdb3Flag[f];
+                sum.hdb3Toggle[f] = !sum.hdb3Toggle[f];
+            }
+        }
+        i = chunk.next(zero, 1);
+        size_t zeros = i - zero;
+        // The first substitution flips the polarity if the flag is set,
+        // every later one in the same run flips it unconditionally.
+        if (zeros >= 4) {
+            size_t subs = zeros / 4;
+            for (int f = 0; f < 2; f++) {
+                if ((subs - 1 + (sum.hdb3Flag[f] ? 1 : 0)) & 1) sum.hdb3Toggle[f] = !sum.hdb3Toggle[f];
+                sum.hdb3Flag[f] = true;
+            }
+        }
+    }
+}
+
+static void advanceState(StreamStart& st, const ChunkSummary& sum, size_t length) {
+    st.ones += sum.ones;
+
+    // HDB3 substitutions completed by the leading zeros, then the rest.
+    size_t subs = (st.zeroRun % 4 + sum.leadingZeros) / 4;
+    if (subs) {
+        if ((subs - 1 + (st.hdb3Even ? 1 : 0)) & 1) st.hdb3High = !st.hdb3High;
+        st.hdb3Even = true;
+    }
+    if (sum.ones) {
+        int f = st.hdb3Even ? 1 : 0;
+        st.hdb3Even = sum.hdb3Flag[f];
+        if (sum.hdb3Toggle[f]) st.hdb3High = !st.hdb3High;
+        st.zeroRun = sum.trailingZeros;
+    } else {
+        st.zeroRun += length;
+    }
+}
+
+// Returns the encoder for a chunk starting in `st` and sets heldBack to the
+// number of symbols it writes before the chunk's first bit.
+static StreamEncoder* makeEncoderAt(LineCode code, const StreamStart& st, size_t& heldBack) {
+    return withScheme(code, [&](auto scheme) {
+        return decltype(scheme)::encoderAt(st, heldBack);
+    });
+}
+
+template <class Fn>
+static void runChunks(size_t count, Fn fn) {
+    vector<thread> pool;
+    for (size_t c = 1; c < count; c++) pool.push_back(thread(fn, c));
+    fn((size_t)0);
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+}
+
+void encodeParallel(LineCode code, BitView bits, int* encoded, unsigned threads) {
+    const size_t minChunkWords = 1024;
+    size_t n = bits.size(), nWords = (n + 63) / 64;
+    if (threads == 0) threads = thread::hardware_concurrency();
+    size_t chunks = min((size_t)max(threads, 1u), max(nWords / minChunkWords, (size_t)1));
+    int spb = symbolsPerBit(code);
+
+    if (chunks == 1) {
+        StreamEncoder* encoder = makeEncoder(code);
+        size_t k = encoder->push(bits, encoded);
+        encoder->finish(encoded + k);
+        delete encoder;
+        return;
+    }
+
+    size_t perChunk = (nWords + chunks - 1) / chunks;
+    chunks = (nWords + perChunk - 1) / perChunk;
+    vector<BitView> parts;
+    for (size_t c = 0; c < chunks; c++) {
+        size_t first = c * perChunk * 64;
+        parts.push_back(bits.slice(c * perChunk, min(n, first + perChunk * 64) - first));
+    }
+
+    vector<ChunkSummary> sums(chunks);
+    runChunks(chunks, [&](size_t c) {
+        summarizeChunk(parts[c], code == LINE_HDB3, sums[c]);
+    });
+
+    vector<StreamStart> starts(chunks);
+    StreamStart st = { 0, 0, true, false };
+    for (size_t c = 0; c < chunks; c++) {
+        starts[c] = st;
+        advanceState(st, sums[c], parts[c].size());
+    }
+
+    runChunks(chunks, [&](size_t c) {
+        size_t heldBack;
+        StreamEncoder* encoder = makeEncoderAt(code, starts[c], heldBack);
+        int* out = encoded + c * perChunk * 64 * spb - heldBack;
+        size_t k = encoder->push(parts[c], out);
+        if (c == chunks - 1) encoder->finish(out + k);
+        delete encoder;
+    });
+}
+
+//DECODING:-
+
+// Decoders take an int symbol stream back to packed bits and return the
+// number of code violations: symbols a scheme can never produce, Manchester
+// pairs without a mid-bit transition, and bipolar violations that are not
+// part of a valid B8ZS/HDB3 substitution. The symbols are first split into a
+// positive and a negative bit plane, so the binary-level codes decode a word
+// at a time with plain bit operations.
+
+typedef void (*SignKernel)(const int* symbols, size_t n, uint64_t* pos, uint64_t* neg);
+
+static void splitSignsScalar(const int* symbols, size_t n, uint64_t* pos, uint64_t* neg) {
+    for (size_t base = 0; base < n; base += 64) {
+        uint64_t p = 0, q = 0;
+        size_t count = min((size_t)64, n - base);
+        for (size_t j = 0; j < count; j++) {
+            if (symbols[base + j] > 0) p |= 1ULL << j;
+            else if (symbols[base + j] < 0) q |= 1ULL << j;
+        }
+        pos[base >> 6] = p;
+        neg[base >> 6] = q;
+    }
+}
+
+#ifdef SIGNAL_X86
+
+__attribute__((target("sse2")))
+static void splitSignsSSE2(const int* symbols, size_t n, uint64_t* pos, uint64_t* neg) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t full = n / 64;
+    for (size_t w = 0; w < full; w++) {
+        uint64_t p = 0, q = 0;
+        const int* src = symbols + w * 64;
+        for (int j = 0; j < 64; j += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + j));
+            p |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, zero))) << j;
+            q |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(v)) << j;
+        }
+        pos[w] = p;
+        neg[w] = q;
+    }
+    splitSignsScalar(symbols + full * 64, n - full * 64, pos + full, neg + full);
+}
+
+__attribute__((target("avx2")))
+static void splitSignsAVX2(const int* symbols, size_t n, uint64_t* pos, uint64_t* neg) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t full = n / 64;
+    for (size_t w = 0; w < full; w++) {
+        uint64_t p = 0, q = 0;
+        const int* src = symbols + w * 64;
+        for (int j = 0; j < 64; j += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + j));
+            p |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, zero))) << j;
+            q |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(v)) << j;
+        }
+        pos[w] = p;
+        neg[w] = q;
+    }
+    splitSignsScalar(symbols + full * 64, n - full * 64, pos + full, neg + full);
+}
+
+static SignKernel splitSigns = pickKernel(splitSignsAVX2, splitSignsSSE2, splitSignsScalar);
+#else
+static const SignKernel splitSigns = splitSignsScalar;
+#endif
+
+static inline uint64_t lowMask(size_t n) {
+    return n >= 64 ? ~0ULL : (1ULL << n) - 1;
+}
+
+// Gathers the even-numbered bits of x into the low 32 bits.
+static inline uint64_t evenBits(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+    return x;
+}
+
+static const size_t decodeBlockWords = 64;
+
+// Where the decoders read symbols from: an int array, split into planes a
+// block at a time, or a SymbolStream, whose planes already exist.
+struct IntSymbols {
+    const int* s;
+    void planes(size_t base, size_t count, uint64_t* pos, uint64_t* neg) const {
+        splitSigns(s + base, count, pos, neg);
+    }
+    int operator[](size_t i) const { return s[i]; }
+};
+
+struct PackedSymbols {
+    const SymbolStream& s;
+    void planes(size_t base, size_t count, uint64_t* pos, uint64_t* neg) const {
+        size_t words = (count + 63) / 64;
+        memcpy(pos, s.pos.words.data() + base / 64, words * sizeof(uint64_t));
+        if (s.ternary) {
+            memcpy(neg, s.neg.words.data() + base / 64, words * sizeof(uint64_t));
+        } else {
+            for (size_t w = 0; w < words; w++) neg[w] = ~pos[w] & lowMask(count - w * 64);
+        }
+    }
+    int operator[](size_t i) const { return s.get(i); }
+};
+
+// NRZ-L, and NRZ-I when `differential`: a level change marks a 1.
+template <class Symbols>
+static size_t decodeLevels(const Symbols& symbols, size_t n, BitStream& bits, bool differential) {
+    uint64_t pos[decodeBlockWords], neg[decodeBlockWords];
+    uint64_t prevHigh = 0;
+    size_t violations = 0;
+    bits.clear();
+    bits.resize(n);
+    for (size_t base = 0; base < n; base += decodeBlockWords * 64) {
+        size_t count = min(decodeBlockWords * 64, n - base);
+        symbols.planes(base, count, pos, neg);
+        for (size_t w = 0; w * 64 < count; w++) {
+            uint64_t valid = lowMask(count - w * 64);
+            uint64_t high = pos[w];
+            violations += __builtin_popcountll(~(high | neg[w]) & valid);
+            if (differential) {
+                bits.words[base / 64 + w] = (high ^ ((high << 1) | prevHigh)) & valid;
+                prevHigh = high >> 63;
+            } else {
+                bits.words[base / 64 + w] = high;
+            }
+        }
+    }
+    return violations;
+}
+
+// Manchester, and Differential Manchester when `differential`. Each output
+// word comes from two plane words: a 1 is a low first half for Manchester,
+// and a change of first-half level from the previous bit for Differential
+// Manchester (whose level before the first bit is high).
+template <class Symbols>
+static size_t decodeManchesterPairs(const Symbols& symbols, size_t n, BitStream& bits, bool differential) {
+    uint64_t pos[decodeBlockWords], neg[decodeBlockWords];
+    size_t pairs = n / 2, violations = n & 1;
+    uint64_t prevHigh = 1;
+    bits.clear();
+    bits.resize(pairs);
+    for (size_t base = 0; base < 2 * pairs; base += decodeBlockWords * 64) {
+        size_t count = min(decodeBlockWords * 64, 2 * pairs - base);
+        symbols.planes(base, count, pos, neg);
+        size_t planeWords = (count + 63) / 64;
+        for (size_t w = 0; w < planeWords; w++) {
+            uint64_t valid = lowMask(count - w * 64) & 0x5555555555555555ULL;
+            uint64_t good = (neg[w] & (pos[w] >> 1)) | (pos[w] & (neg[w] >> 1));
+            violations += __builtin_popcountll(valid & ~good);
+        }
+        for (size_t w = 0; w < planeWords; w += 2) {
+            uint64_t hiPos = (w + 1 < planeWords) ? pos[w + 1] : 0;
+            uint64_t hiNeg = (w + 1 < planeWords) ? neg[w + 1] : 0;
+            uint64_t valid = lowMask((count - w * 64) / 2);
+            uint64_t word;
+            if (differential) {
+                uint64_t high = evenBits(pos[w]) | (evenBits(hiPos) << 32);
+                word = (high ^ ((high << 1) | prevHigh)) & valid;
+                prevHigh = high >> 63;
+            } else {
+                word = evenBits(neg[w]) | (evenBits(hiNeg) << 32);
+            }
+            bits.words[(base / 2 + w * 32) / 64] = word;
+        }
+    }
+    return violations;
+}
+
+// B8ZS: 000VB0VB, where V repeats the polarity of the last real pulse.
+template <class Symbols>
+static bool isB8ZSSubstitution(const Symbols& s, size_t n, size_t j, int last) {
+    return j >= 3 && j + 4 < n && s[j-3] == 0 && s[j-2] == 0 && s[j-1] == 0 &&
+           s[j+1] == -last && s[j+2] == 0 && s[j+3] == -last && s[j+4] == last;
+}
+
+// AMI and its scrambled forms. Only pulses are visited: the pulse plane is
+// walked with BitView::next(), so long zero runs cost one step per word.
+template <class Symbols>
+static size_t decodeBipolar(const Symbols& symbols, size_t n, BitStream& bits, LineCode code) {
+    uint64_t pos[decodeBlockWords], neg[decodeBlockWords];
+    size_t violations = 0;
+    bits.clear();
+    bits.resize(n);
+    for (size_t base = 0; base < n; base += decodeBlockWords * 64) {
+        size_t count = min(decodeBlockWords * 64, n - base);
+        symbols.planes(base, count, pos, neg);
+        for (size_t w = 0; w * 64 < count; w++) bits.words[base / 64 + w] = pos[w] | neg[w];
+    }
+
+    BitView pulses = bits;
+    int last = -1;
+    for (size_t j = pulses.next(0, 1); j < n; ) {
+        int pol = symbols[j] > 0 ? 1 : -1;
+        size_t resume = j + 1;
+        if (pol == last) {
+            if (code == LINE_B8ZS && isB8ZSSubstitution(symbols, n, j, last)) {
+                bits.set(j, 0);
+                bits.set(j + 1, 0);
+                bits.set(j + 3, 0);
+                bits.set(j + 4, 0);
+                resume = j + 5;
+            } else if (code == LINE_HDB3 && j >= 3 && symbols[j-1] == 0 && symbols[j-2] == 0) {
+                // 000V, or B00V where B was taken for a 1 a moment ago
+                bits.set(j, 0);
+                bits.set(j - 3, 0);
+            } else {
+                violations++;
+            }
+        }
+        last = pol;
+        j = pulses.next(resume, 1);
+    }
+    return violations;
+}
+
+size_t decodeNRZL(const int* symbols, size_t n, BitStream& bits) {
+    IntSymbols src = { symbols };
+    return decodeLevels(src, n, bits, false);
+}
+
+size_t decodeNRZI(const int* symbols, size_t n, BitStream& bits) {
+    IntSymbols src = { symbols };
+    return decodeLevels(src, n, bits, true);
+}
+
+size_t decodeManchester(const int* symbols, size_t n, BitStream& bits) {
+    IntSymbols src = { symbols };
+    return decodeManchesterPairs(src, n, bits, false);
+}
+
+size_t decodeDiffManchester(const int* symbols, size_t n, BitStream& bits) {
+    IntSymbols src = { symbols };
+    return decodeManchesterPairs(src, n, bits, true);
+}
+
+size_t decodeAMI(const int* symbols, size_t n, BitStream& bits) {
+    IntSymbols src = { symbols };
+    return decodeBipolar(src, n, bits, LINE_AMI);
+}
+
+size_t descrambleB8ZS(const int* symbols, size_t n, BitStream& bits) {
+    IntSymbols src = { symbols };
+    return decodeBipolar(src, n, bits, LINE_B8ZS);
+}
+
+size_t descrambleHDB3(const int* symbols, size_t n, BitStream& bits) {
+    IntSymbols src = { symbols };
+    return decodeBipolar(src, n, bits, LINE_HDB3);
+}
+
+// Through the kernel the code's policy names, or its per-bit rules.
+template <class Symbols>
+static size_t decodeScheme(LineCode code, const Symbols& src, size_t n, BitStream& bits) {
+    return withScheme(code, [&](auto scheme) -> size_t {
+        typedef decltype(scheme) Scheme;
+        switch (Scheme::decodeKernel) {
+            case KERNEL_LEVELS: return decodeLevels(src, n, bits, Scheme::differential);
+            case KERNEL_PAIRS: return decodeManchesterPairs(src, n, bits, Scheme::differential);
+            case KERNEL_BIPOLAR: return decodeBipolar(src, n, bits, code);
+            default: return decode<Scheme>(src, n, bits);
+        }
+    });
+}
+
+size_t decodeSignal(LineCode code, const int* symbols, size_t n, BitStream& bits) {
+    IntSymbols src = { symbols };
+    return decodeScheme(code, src, n, bits);
+}
+
+//PACKED SYMBOLS:-
+
+// A SymbolStream costs one bit per symbol for the binary-level codes and two
+// for AMI and its scrambled forms, against 32 for an int. The binary codes
+// and AMI are built a word at a time from the input and its running parity;
+// B8ZS and HDB3 run their streaming encoder over a small int buffer that is
+// split into planes every 64 symbols.
+
+// Spreads the low 32 bits of x to the even bit positions.
+static inline uint64_t spreadBits(uint64_t x) {
+    x &= 0x00000000FFFFFFFFULL;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+// Manchester pos plane: a 0 bit is (+1, -1), a 1 bit is (-1, +1).
+static void manchesterPlane(const uint64_t* words, size_t n, uint64_t* out) {
+    size_t outWords = (2 * n + 63) / 64;
+    for (size_t w = 0; 2 * w < outWords; w++) {
+        uint64_t x = words[w];
+        out[2 * w] = (spreadBits(x) << 1) | spreadBits(~x);
+        if (2 * w + 1 < outWords) out[2 * w + 1] = (spreadBits(x >> 32) << 1) | spreadBits(~x >> 32);
+    }
+}
+
+// Clears the bits past the end of the last word.
+static void trimPlane(BitStream& plane) {
+    if (plane.length & 63) plane.words.back() &= lowMask(plane.length & 63);
+}
+
+// Running digital sum over the 8 binary symbols of a byte (a set bit is +1,
+// a clear one -1) and over the 4 ternary symbols of a nibble pair (+1s in
+// the low nibble, -1s in the high): the total, then the lowest and highest
+// partial sums, the empty one included.
+struct DigitalSumTables {
+    int8_t binary[256][3];
+    int8_t ternary[256][3];
+
+    constexpr DigitalSumTables() : binary(), ternary() {
+        for (int v = 0; v < 256; v++) {
+            int sum = 0, lo = 0, hi = 0;
+            for (int i = 0; i < 8; i++) {
+                sum += (v >> i & 1) ? 1 : -1;
+                lo = sum < lo ? sum : lo;
+                hi = sum > hi ? sum : hi;
+            }
+            binary[v][0] = (int8_t)sum, binary[v][1] = (int8_t)lo, binary[v][2] = (int8_t)hi;
+            sum = lo = hi = 0;
+            for (int i = 0; i < 4; i++) {
+                sum += (v >> i & 1) - (v >> (i + 4) & 1);
+                lo = sum < lo ? sum : lo;
+                hi = sum > hi ? sum : hi;
+            }
+            ternary[v][0] = (int8_t)sum, ternary[v][1] = (int8_t)lo, ternary[v][2] = (int8_t)hi;
+        }
+    }
+};
+
+static constexpr DigitalSumTables digitalSums;
+
+static_assert(digitalSums.binary[0x0F][0] == 0 && digitalSums.binary[0x0F][2] == 4, "binary sums");
+static_assert(digitalSums.ternary[0x12][0] == 0 && digitalSums.ternary[0x12][1] == -1, "ternary sums");
+
+// True when x has t set bits in a row. Each step doubles the length of the
+// rows that bit i marks the start of.
+static inline bool hasRunOfOnes(uint64_t x, size_t t) {
+    if (t > 64) return false;
+    size_t k = 1;
+    for (; 2 * k <= t; k *= 2) x &= x >> k;
+    if (k < t) x &= x >> (t - k);
+    return x != 0;
+}
+
+// Fills in SignalStats from plane words handed over in order, with word-wide
+// bit operations wherever it can:
+//  - transitions are the popcount of the word of level changes;
+//  - a word's runs are only bit-scanned one by one when one of them could be
+//    longer than the longest run of its level so far, otherwise just the
+//    first and last change are found, to close and open the runs that cross
+//    the word's edges;
+//  - the digital sum goes a byte or nibble pair at a time through the tables
+//    above;
+//  - bipolar violations compare each pulse with the polarity of the pulse
+//    before it, which is carried forward over the zeros between them in six
+//    doubling steps.
+class StatsScanner {
+public:
+    StatsScanner(LineCode code, SignalStats& s)
+        : stats(s), ternary(isTernary(code)), bipolar(isBipolar(code)),
+          manchester(symbolsPerBit(code) == 2),
+          prevPos(0), prevNeg(0), lastPositive(0), pulseSeen(0), level(0), runFrom(0), done(0) {
+        stats = SignalStats();
+        stats.code = code;
+    }
+
+    // count symbols from pos/neg; every call but the last is whole words.
+    void scan(const uint64_t* pos, const uint64_t* neg, size_t count) {
+        for (size_t w = 0; w * 64 < count; w++) {
+            size_t valid = min(count - w * 64, (size_t)64);
+            uint64_t mask = lowMask(valid);
+            uint64_t p = pos[w] & mask, q = ternary ? neg[w] & mask : 0;
+            if (done == 0) {
+                prevPos = p & 1;
+                prevNeg = q & 1;
+                level = levelAt(p, q, 0);
+            }
+
+            uint64_t changes = ((p ^ ((p << 1) | prevPos)) | (q ^ ((q << 1) | prevNeg))) & mask;
+            stats.transitions += __builtin_popcountll(changes);
+            if (changes) scanRuns(p, q, changes, mask);
+
+            addSums(p, q, valid);
+            if (manchester) stats.violations += __builtin_popcountll(~(p ^ (p >> 1)) & mask & (mask >> 1) & 0x5555555555555555ULL);
+            if (bipolar) countViolations(p, q);
+            prevPos = p >> (valid - 1) & 1;
+            prevNeg = q >> (valid - 1) & 1;
+            done += valid;
+        }
+    }
+
+    void finish() {
+        if (done) closeRun(done);
+        stats.symbols = done;
+    }
+
+private:
+    SignalStats& stats;
+    bool ternary, bipolar, manchester;
+    uint64_t prevPos, prevNeg;
+    uint64_t lastPositive, pulseSeen;   // the last pulse so far: positive, and whether there was one
+    int level;
+    size_t runFrom, done;
+
+    int levelAt(uint64_t p, uint64_t q, int at) const {
+        if (p >> at & 1) return 1;
+        return (!ternary || (q >> at & 1)) ? -1 : 0;
+    }
+
+    void closeRun(size_t end) {
+        size_t length = end - runFrom;
+        if (length > stats.longestRun[level + 1]) {
+            stats.longestRun[level + 1] = length;
+            stats.runStart[level + 1] = runFrom;
+        }
+        runFrom = end;
+    }
+
+    void scanRuns(uint64_t p, uint64_t q, uint64_t changes, uint64_t mask) {
+        // A run inside the word that sets a record has longestRun symbols
+        // after its first that each repeat the one before.
+        uint64_t same = ~changes & mask;
+        uint64_t levels[3] = { ternary ? q : ~p & mask, ~(p | q) & mask, p };
+        bool record = false;
+        for (int l = 0; l < 3 && !record; l++) {
+            if (!ternary && l == 1) continue;
+            size_t longest = stats.longestRun[l];
+            record = longest ? hasRunOfOnes(same & levels[l], longest) : levels[l] != 0;
+        }
+        if (record) {
+            for (; changes; changes &= changes - 1) {
+                int at = __builtin_ctzll(changes);
+                closeRun(done + at);
+                level = levelAt(p, q, at);
+            }
+        } else {
+            closeRun(done + __builtin_ctzll(changes));
+            int last = 63 - __builtin_clzll(changes);
+            runFrom = done + last;
+            level = levelAt(p, q, last);
+        }
+    }
+
+    void countViolations(uint64_t p, uint64_t q) {
+        uint64_t pulses = p | q, positive = p, known = pulses;
+        for (int s = 1; s < 64; s *= 2) {
+            positive |= (positive << s) & ~known;
+            known |= known << s;
+        }
+        positive |= -lastPositive & ~known;
+        known |= -pulseSeen;
+        // Bit i of before/had: the last pulse before symbol i, and whether there was one.
+        uint64_t before = (positive << 1) | lastPositive, had = (known << 1) | pulseSeen;
+        stats.violations += __builtin_popcountll(pulses & had & ~(p ^ before));
+        lastPositive = positive >> 63;
+        pulseSeen = known >> 63;
+    }
+
+    void addSums(uint64_t p, uint64_t q, size_t valid) {
+        long long dc = stats.dc, lo = stats.minDC, hi = stats.maxDC;
+        size_t i = 0;
+        if (ternary) {
+            for (; i + 4 <= valid; i += 4) {
+                const int8_t* sums = digitalSums.ternary[(p >> i & 15) | (q >> i & 15) << 4];
+                lo = min(lo, dc + sums[1]);
+                hi = max(hi, dc + sums[2]);
+                dc += sums[0];
+            }
+        } else {
+            for (; i + 8 <= valid; i += 8) {
+                const int8_t* sums = digitalSums.binary[p >> i & 255];
+                lo = min(lo, dc + sums[1]);
+                hi = max(hi, dc + sums[2]);
+                dc += sums[0];
+            }
+        }
+        for (; i < valid; i++) {
+            dc += levelAt(p, q, (int)i);
+            lo = min(lo, dc);
+            hi = max(hi, dc);
+        }
+        stats.dc = dc, stats.minDC = lo, stats.maxDC = hi;
+    }
+};
+
+StatsTracker::StatsTracker(LineCode code, SignalStats& s)
+    : stats(s), scanner(new StatsScanner(code, s)), held(0) {}
+
+StatsTracker::~StatsTracker() {
+    delete scanner;
+}
+
+void StatsTracker::pushBits(BitView bits) {
+    size_t nWords = (bits.size() + 63) / 64;
+    for (size_t w = 0; w < nWords; w++) stats.ones += __builtin_popcountll(bits.words[w]);
+    stats.bits += bits.size();
+}
+
+void StatsTracker::pushSymbols(const int* symbols, size_t n) {
+    // The scanner takes whole words until the last call, so a partial word
+    // waits in pending for the next block.
+    size_t i = 0;
+    if (held) {
+        i = min(n, 64 - held);
+        memcpy(pending + held, symbols, i * sizeof(int));
+        held += i;
+        if (held < 64) return;
+        scan(pending, 64);
+        held = 0;
+    }
+    size_t whole = (n - i) / 64 * 64;
+    if (whole) scan(symbols + i, whole);
+    held = n - i - whole;
+    memcpy(pending, symbols + i + whole, held * sizeof(int));
+}
+
+void StatsTracker::finish() {
+    if (held) scan(pending, held);
+    held = 0;
+    scanner->finish();
+}
+
+void StatsTracker::scan(const int* symbols, size_t n) {
+    uint64_t pos[64], neg[64];
+    for (size_t i = 0; i < n; i += 64 * 64) {
+        size_t count = min((size_t)64 * 64, n - i);
+        splitSigns(symbols + i, count, pos, neg);
+        scanner->scan(pos, neg, count);
+    }
+}
+
+static void encodeSymbolsStreamed(LineCode code, BitView bits, SymbolStream& symbols,
+                                  StatsScanner* scanner) {
+    const size_t blockBits = 64 * 64;
+    StreamEncoder* encoder = makeEncoder(code);
+    vector<int> staging(64 + encoder->maxOutput(blockBits));
+    size_t n = bits.size(), pending = 0, done = 0;
+    for (size_t base = 0; ; base += blockBits) {
+        bool last = base >= n;
+        if (last) pending += encoder->finish(staging.data() + pending);
+        else pending += encoder->push(bits.slice(base / 64, min(blockBits, n - base)), staging.data() + pending);
+        // Split whole words only, so every plane write stays word-aligned.
+        size_t ready = last ? pending : pending / 64 * 64;
+        if (ready) splitSigns(staging.data(), ready, symbols.pos.words.data() + done / 64,
+                              symbols.neg.words.data() + done / 64);
+        if (ready && scanner) scanner->scan(symbols.pos.words.data() + done / 64,
+                                            symbols.neg.words.data() + done / 64, ready);
+        memmove(staging.data(), staging.data() + ready, (pending - ready) * sizeof(int));
+        done += ready;
+        pending -= ready;
+        if (last) break;
+    }
+    delete encoder;
+}
+
+// The input goes through in blocks of 64 words, small enough that each
+// block's planes are still in L1 when the statistics scan reads them.
+void encodeSymbols(LineCode code, BitView bits, SymbolStream& symbols, SignalStats* stats) {
+    const size_t blockWords = 64;
+    size_t n = bits.size(), nWords = (n + 63) / 64;
+    symbols.clear();
+    symbols.ternary = isTernary(code);
+    symbols.pos.resize(n * symbolsPerBit(code));
+    if (symbols.ternary) symbols.neg.resize(symbols.pos.size());
+    StatsScanner* scanner = stats ? new StatsScanner(code, *stats) : NULL;
+
+    uint64_t* pos = symbols.pos.words.data();
+    uint64_t* neg = symbols.neg.words.data();
+    uint64_t parity[blockWords], carry = 0;
+    CodeKernels kernels = codeKernels(code);
+
+    // Codes with no plane kernel, the scramblers among them, go through
+    // their stream encoder.
+    if (kernels.planes == KERNEL_NONE) {
+        if (n) encodeSymbolsStreamed(code, bits, symbols, scanner);
+        for (size_t w = 0; stats && w < nWords; w++) stats->ones += __builtin_popcountll(bits.words[w]);
+    } else {
+        for (size_t w = 0; w < nWords; w += blockWords) {
+            size_t count = min(blockWords, nWords - w), blockBits = min(blockWords * 64, n - w * 64);
+            const uint64_t* in = bits.words + w;
+            if (kernels.differential) carry = prefixParity(in, parity, count, carry);
+            const uint64_t* levels = kernels.differential ? parity : in;
+            switch (kernels.planes) {
+                case KERNEL_LEVELS:
+                    memcpy(pos + w, levels, count * sizeof(uint64_t));
+                    break;
+                case KERNEL_PAIRS:
+                    manchesterPlane(levels, blockBits, pos + 2 * w);
+                    break;
+                default:
+                    // AMI, which is differential: the first pulse is +1, so
+                    // a pulse is positive when the count of ones up to and
+                    // including it is odd.
+                    for (size_t i = 0; i < count; i++) {
+                        pos[w + i] = in[i] & parity[i];
+                        neg[w + i] = in[i] & ~parity[i];
+                    }
+                    break;
+            }
+            if (scanner) {
+                size_t per = symbolsPerBit(code);
+                for (size_t i = 0; i < count; i++) stats->ones += __builtin_popcountll(in[i]);
+                scanner->scan(pos + per * w, symbols.ternary ? neg + w : NULL, per * blockBits);
+            }
+        }
+    }
+    trimPlane(symbols.pos);
+    trimPlane(symbols.neg);
+    if (scanner) {
+        scanner->finish();
+        stats->bits = n;
+        delete scanner;
+    }
+}
+
+void packSymbols(const int* symbols, size_t n, bool ternary, SymbolStream& packed) {
+    packed.clear();
+    packed.ternary = ternary;
+    packed.pos.resize(n);
+    packed.neg.resize(n);
+    if (n) splitSigns(symbols, n, packed.pos.words.data(), packed.neg.words.data());
+    if (!ternary) packed.neg.clear();
+}
+
+void appendSymbols(const int* symbols, size_t n, SymbolStream& packed) {
+    size_t at = packed.size(), i = 0;
+    packed.pos.resize(at + n);
+    if (packed.ternary) packed.neg.resize(at + n);
+    // One at a time up to a word boundary, then whole words.
+    for (; i < n && ((at + i) & 63); i++) {
+        packed.pos.set(at + i, symbols[i] > 0);
+        if (packed.ternary) packed.neg.set(at + i, symbols[i] < 0);
+    }
+    uint64_t spare[64];
+    for (; i < n; i += 64 * 64) {
+        size_t count = min((size_t)64 * 64, n - i), w = (at + i) / 64;
+        splitSigns(symbols + i, count, packed.pos.words.data() + w,
+                   packed.ternary ? packed.neg.words.data() + w : spare);
+    }
+}
+
+void unpackSymbols(const SymbolStream& packed, size_t first, size_t n, int* out) {
+    if (!packed.ternary && (first & 63) == 0) {
+        if (n) expandLevels(packed.pos.words.data() + first / 64, n, out);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) out[i] = packed.get(first + i);
+}
+
+size_t decodeSignal(LineCode code, const SymbolStream& symbols, BitStream& bits) {
+    PackedSymbols src = { symbols };
+    return decodeScheme(code, src, symbols.size(), bits);
+}
+
+// Level 0 summarises one plane word; each level above pairs up the nodes of
+// the one below. A change bit marks a symbol that differs from the symbol
+// before it, so a range's transitions are its change bits past the first.
+
+SymbolPyramid::Node SymbolPyramid::wordNode(size_t w, uint64_t valid) const {
+    const uint64_t* pos = symbols->pos.words.data();
+    const uint64_t* neg = symbols->neg.words.data();
+    bool ternary = symbols->ternary;
+    uint64_t p = pos[w], q = ternary ? neg[w] : ~pos[w];
+    // The symbol before bit 0: the last one of the previous word, or itself.
+    uint64_t pPrev = w ? pos[w - 1] >> 63 : p & 1;
+    uint64_t qPrev = w ? (ternary ? neg[w - 1] >> 63 : ~pos[w - 1] >> 63) : q & 1;
+    uint64_t changes = ((p ^ ((p << 1) | pPrev)) | (q ^ ((q << 1) | qPrev))) & valid;
+    p &= valid;
+    q &= valid;
+    bool anyZero = (valid & ~(p | q)) != 0;
+
+    Node node;
+    node.hi = p ? 1 : (anyZero ? 0 : -1);
+    node.lo = q ? -1 : (anyZero ? 0 : 1);
+    node.changes = (uint32_t)__builtin_popcountll(changes);
+    return node;
+}
+
+void SymbolPyramid::build(const SymbolStream& stream) {
+    symbols = &stream;
+    levels.clear();
+    size_t n = stream.size(), nWords = n / 64;
+    if (nWords == 0) return;
+
+    // Only whole words go in; summarize() reads the tail from the planes.
+    levels.push_back(vector<Node>(nWords));
+    for (size_t w = 0; w < nWords; w++) levels[0][w] = wordNode(w, ~0ULL);
+
+    // Stop before a node's change count could pass 32 bits.
+    for (size_t block = 128; levels.back().size() > 1 && block <= ((size_t)1 << 31); block *= 2) {
+        const vector<Node>& below = levels.back();
+        vector<Node> above((below.size() + 1) / 2);
+        for (size_t j = 0; j < above.size(); j++) {
+            Node node = below[2 * j];
+            if (2 * j + 1 < below.size()) {
+                const Node& right = below[2 * j + 1];
+                node.lo = min(node.lo, right.lo);
+                node.hi = max(node.hi, right.hi);
+                node.changes += right.changes;
+            }
+            above[j] = node;
+        }
+        levels.push_back(above);
+    }
+}
+
+SymbolSummary SymbolPyramid::summarize(size_t first, size_t n) const {
+    SymbolSummary sum = { 1, -1, 0 };
+    size_t last = first + n;   // one past the end
+    size_t wFirst = (first + 63) / 64, wLast = last / 64;
+
+    // Ranges inside one word, and the partial words at either end.
+    if (wFirst > wLast) {
+        wFirst = wLast = first / 64;
+        Node node = wordNode(first / 64, lowMask(last - wFirst * 64) & (~0ULL << (first & 63)));
+        sum.lo = node.lo;
+        sum.hi = node.hi;
+        sum.transitions = node.changes;
+    } else {
+        if (first & 63) {
+            Node node = wordNode(first / 64, ~0ULL << (first & 63));
+            sum.lo = min(sum.lo, (int)node.lo);
+            sum.hi = max(sum.hi, (int)node.hi);
+            sum.transitions += node.changes;
+        }
+        if (last & 63) {
+            Node node = wordNode(wLast, lowMask(last & 63));
+            sum.lo = min(sum.lo, (int)node.lo);
+            sum.hi = max(sum.hi, (int)node.hi);
+            sum.transitions += node.changes;
+        }
+        // Whole words: climb while both ends sit on node boundaries.
+        size_t l = wFirst, r = wLast;
+        for (size_t k = 0; l < r; k++) {
+            const vector<Node>& level = levels[k];
+            if (k + 1 == levels.size()) {
+                for (; l < r; l++) {
+                    sum.lo = min(sum.lo, (int)level[l].lo);
+                    sum.hi = max(sum.hi, (int)level[l].hi);
+                    sum.transitions += level[l].changes;
+                }
+                break;
+            }
+            if (l & 1) {
+                sum.lo = min(sum.lo, (int)level[l].lo);
+                sum.hi = max(sum.hi, (int)level[l].hi);
+                sum.transitions += level[l].changes;
+                l++;
+            }
+            if (r & 1) {
+                r--;
+                sum.lo = min(sum.lo, (int)level[r].lo);
+                sum.hi = max(sum.hi, (int)level[r].hi);
+                sum.transitions += level[r].changes;
+            }
+            l >>= 1;
+            r >>= 1;
+        }
+    }
+
+    // The first symbol's change bit compares it with a symbol outside.
+    if (first > 0 && symbols->get(first) != symbols->get(first - 1)) sum.transitions--;
+    return sum;
+}
+
+//MODULATION:-
+
+// PCM kernels. The range scan and the quantiser take the widest vector unit
+// available; codes are then packed MSB first into the bit stream.
+
+typedef void (*RangeKernel)(const double* in, size_t n, double& lo, double& hi);
+typedef void (*QuantizeKernel)(const double* in, size_t n, const double* k, int* out);
+
+static void sampleRangeScalar(const double* in, size_t n, double& lo, double& hi) {
+    for (size_t i = 0; i < n; i++) {
+        if (in[i] > hi) hi = in[i];
+        if (in[i] < lo) lo = in[i];
+    }
+}
+
+// k = { lo, scale, step, top }. The code is (x - lo) * scale, clipped to
+// [0, top] and truncated; the clip comes first, so a NaN sample becomes 0
+// rather than an undefined conversion. The rounded reciprocal can put a
+// sample right on a step boundary one step off, so the code is checked
+// against its own step and the next with one multiply each.
+static void quantizeScalar(const double* in, size_t n, const double* k, int* out) {
+    for (size_t i = 0; i < n; i++) {
+        double d = in[i] - k[0], v = d * k[1];
+        double q = (double)(int)(v > 0.0 ? min(v, k[3]) : 0.0);
+        if ((q + 1) * k[2] <= d && q < k[3]) q += 1;
+        else if (q * k[2] > d && q > 0) q -= 1;
+        out[i] = (int)q;
+    }
+}
+
+#ifdef SIGNAL_X86
+
+__attribute__((target("sse2")))
+static void sampleRangeSSE2(const double* in, size_t n, double& lo, double& hi) {
+    size_t full = n & ~(size_t)1;
+    __m128d vlo = _mm_set1_pd(lo), vhi = _mm_set1_pd(hi);
+    for (size_t i = 0; i < full; i += 2) {
+        __m128d v = _mm_loadu_pd(in + i);
+        vlo = _mm_min_pd(vlo, v);
+        vhi = _mm_max_pd(vhi, v);
+    }
+    double l[2], h[2];
+    _mm_storeu_pd(l, vlo);
+    _mm_storeu_pd(h, vhi);
+    lo = min(l[0], l[1]);
+    hi = max(h[0], h[1]);
+    sampleRangeScalar(in + full, n - full, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void sampleRangeAVX2(const double* in, size_t n, double& lo, double& hi) {
+    size_t full = n & ~(size_t)7;
+    __m256d lo0 = _mm256_set1_pd(lo), lo1 = lo0, hi0 = _mm256_set1_pd(hi), hi1 = hi0;
+    for (size_t i = 0; i < full; i += 8) {
+        __m256d a = _mm256_loadu_pd(in + i), b = _mm256_loadu_pd(in + i + 4);
+        lo0 = _mm256_min_pd(lo0, a);
+        lo1 = _mm256_min_pd(lo1, b);
+        hi0 = _mm256_max_pd(hi0, a);
+        hi1 = _mm256_max_pd(hi1, b);
+    }
+    double l[4], h[4];
+    _mm256_storeu_pd(l, _mm256_min_pd(lo0, lo1));
+    _mm256_storeu_pd(h, _mm256_max_pd(hi0, hi1));
+    lo = min(min(l[0], l[1]), min(l[2], l[3]));
+    hi = max(max(h[0], h[1]), max(h[2], h[3]));
+    sampleRangeScalar(in + full, n - full, lo, hi);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i quantizeStepSSE2(__m128d x, __m128d lo, __m128d scale, __m128d step, __m128d top) {
+    __m128d d = _mm_sub_pd(x, lo);
+    // max(v, 0) returns 0 for a NaN v.
+    __m128d v = _mm_min_pd(_mm_max_pd(_mm_mul_pd(d, scale), _mm_setzero_pd()), top);
+    __m128d q = _mm_cvtepi32_pd(_mm_cvttpd_epi32(v));
+    __m128d one = _mm_set1_pd(1.0), next = _mm_add_pd(q, one);
+    __m128d up = _mm_and_pd(_mm_cmple_pd(_mm_mul_pd(next, step), d), _mm_cmplt_pd(q, top));
+    __m128d down = _mm_and_pd(_mm_cmpgt_pd(_mm_mul_pd(q, step), d), _mm_cmpgt_pd(q, _mm_setzero_pd()));
+    q = _mm_add_pd(q, _mm_sub_pd(_mm_and_pd(up, one), _mm_and_pd(down, one)));
+    return _mm_cvttpd_epi32(q);
+}
+
+__attribute__((target("sse2")))
+static void quantizeSSE2(const double* in, size_t n, const double* k, int* out) {
+    size_t full = n & ~(size_t)3;
+    __m128d lo = _mm_set1_pd(k[0]), scale = _mm_set1_pd(k[1]), step = _mm_set1_pd(k[2]), top = _mm_set1_pd(k[3]);
+    for (size_t i = 0; i < full; i += 4) {
+        __m128i a = quantizeStepSSE2(_mm_loadu_pd(in + i), lo, scale, step, top);
+        __m128i b = quantizeStepSSE2(_mm_loadu_pd(in + i + 2), lo, scale, step, top);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi64(a, b));
+    }
+    quantizeScalar(in + full, n - full, k, out + full);
+}
+
+__attribute__((target("avx2")))
+static inline __m128i quantizeStepAVX2(__m256d x, __m256d lo, __m256d scale, __m256d step, __m256d top) {
+    __m256d d = _mm256_sub_pd(x, lo);
+    __m256d v = _mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(d, scale), _mm256_setzero_pd()), top);
+    __m256d q = _mm256_round_pd(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256d one = _mm256_set1_pd(1.0), next = _mm256_add_pd(q, one);
+    __m256d up = _mm256_and_pd(_mm256_cmp_pd(_mm256_mul_pd(next, step), d, _CMP_LE_OQ),
+                               _mm256_cmp_pd(q, top, _CMP_LT_OQ));
+    __m256d down = _mm256_and_pd(_mm256_cmp_pd(_mm256_mul_pd(q, step), d, _CMP_GT_OQ),
+                                 _mm256_cmp_pd(q, _mm256_setzero_pd(), _CMP_GT_OQ));
+    q = _mm256_add_pd(q, _mm256_sub_pd(_mm256_and_pd(up, one), _mm256_and_pd(down, one)));
+    return _mm256_cvttpd_epi32(q);
+}
+
+__attribute__((target("avx2")))
+static void quantizeAVX2(const double* in, size_t n, const double* k, int* out) {
+    size_t full = n & ~(size_t)7;
+    __m256d lo = _mm256_set1_pd(k[0]), scale = _mm256_set1_pd(k[1]);
+    __m256d step = _mm256_set1_pd(k[2]), top = _mm256_set1_pd(k[3]);
+    for (size_t i = 0; i < full; i += 8) {
+        __m128i a = quantizeStepAVX2(_mm256_loadu_pd(in + i), lo, scale, step, top);
+        __m128i b = quantizeStepAVX2(_mm256_loadu_pd(in + i + 4), lo, scale, step, top);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_set_m128i(b, a));
+    }
+    quantizeScalar(in + full, n - full, k, out + full);
+}
+
+static RangeKernel sampleRange = pickKernel(sampleRangeAVX2, sampleRangeSSE2, sampleRangeScalar);
+static QuantizeKernel quantize = pickKernel(quantizeAVX2, quantizeSSE2, quantizeScalar);
+#else
+static const RangeKernel sampleRange = sampleRangeScalar;
+static const QuantizeKernel quantize = quantizeScalar;
+#endif
+
+// Picks every kernel above again, from the scalar loops up to level.
+SimdLevel setSimdLevel(SimdLevel level) {
+    simdLevel = min(level, cpuSimdLevel());
+#ifdef SIGNAL_X86
+    expandLevels = pickKernel(expandLevelsAVX2, expandLevelsSSE2, expandLevelsScalar);
+    expandManchester = pickKernel(expandManchesterAVX2, expandManchesterSSE2, expandManchesterScalar);
+    prefixParity = pickParityKernel();
+    splitSigns = pickKernel(splitSignsAVX2, splitSignsSSE2, splitSignsScalar);
+    sampleRange = pickKernel(sampleRangeAVX2, sampleRangeSSE2, sampleRangeScalar);
+    quantize = pickKernel(quantizeAVX2, quantizeSSE2, quantizeScalar);
+#endif
+    return simdLevel;
+}
+
+// ORs n codes of `width` bits, MSB first, into the stream from bit `at`. The
+// words from there on must be zero past `at`.
+static void packCodes(const int* codes, size_t n, int width, uint64_t* words, size_t at) {
+    if (n == 0) return;
+    uint64_t* w = words + (at >> 6);
+    int fill = (int)(at & 63);
+    uint64_t acc = *w;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = (uint32_t)codes[i];
+        v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+        v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+        v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+        v = __builtin_bswap32(v) >> (32 - width);
+        acc |= (uint64_t)v << fill;
+        fill += width;
+        if (fill >= 64) {
+            *w++ = acc;
+            fill -= 64;
+            acc = (uint64_t)v >> (width - fill);
+        }
+    }
+    if (fill) *w = acc;
+}
+
+// Samples in [minVal, maxVal] map onto 2^width equal steps: k is the
+// { lo, scale, step, top } the kernels take. scale is the reciprocal of the
+// step, so quantising is a multiply rather than a divide. An empty range
+// puts every sample in code 0.
+static void pcmScale(int width, double minVal, double maxVal, double* k) {
+    double levels = ldexp(1.0, width);
+    bool empty = !(maxVal > minVal);
+    k[0] = minVal;
+    k[1] = empty ? 0.0 : levels / (maxVal - minVal);
+    k[2] = empty ? HUGE_VAL : (maxVal - minVal) / levels;
+    k[3] = levels - 1;
+}
+
+static void quantizeInto(const double* in, size_t n, const double* k, int width,
+                         uint64_t* words, size_t at) {
+    const size_t block = 256;
+    int codes[block];
+    for (size_t i = 0; i < n; i += block) {
+        size_t m = min(block, n - i);
+        quantize(in + i, m, k, codes);
+        packCodes(codes, m, width, words, at + i * width);
+    }
+}
+
+// Two passes over the input, each split across the threads: a min/max
+// reduction, then the quantiser. Chunks hold a multiple of 64 samples, so
+// every chunk's bits start on a word boundary.
+size_t encodePCM(const double* analog, size_t samples, BitStream& bits, int bitsPerSample,
+                 unsigned threads) {
+    bits.clear();
+    if (samples == 0) return 0;
+
+    const size_t minChunkSamples = (size_t)1 << 16;
+    if (threads == 0) threads = thread::hardware_concurrency();
+    size_t chunks = min((size_t)max(threads, 1u), max(samples / minChunkSamples, (size_t)1));
+    size_t perChunk = ((samples + chunks - 1) / chunks + 63) & ~(size_t)63;
+    chunks = (samples + perChunk - 1) / perChunk;
+
+    vector<double> lo(chunks, analog[0]), hi(chunks, analog[0]);
+    runChunks(chunks, [&](size_t c) {
+        size_t first = c * perChunk;
+        sampleRange(analog + first, min(perChunk, samples - first), lo[c], hi[c]);
+    });
+    double minVal = *min_element(lo.begin(), lo.end());
+    double maxVal = *max_element(hi.begin(), hi.end());
+
+    double k[4];
+    pcmScale(bitsPerSample, minVal, maxVal, k);
+    bits.resize(samples * bitsPerSample);
+    runChunks(chunks, [&](size_t c) {
+        size_t first = c * perChunk;
+        quantizeInto(analog + first, min(perChunk, samples - first), k, bitsPerSample,
+                     bits.words.data(), first * bitsPerSample);
+    });
+    return bits.size();
+}
+
+PCMEncoder::PCMEncoder(int bitsPerSample, double minVal, double maxVal)
+    : width(bitsPerSample), calibration(0) {
+    setRange(minVal, maxVal);
+}
+
+PCMEncoder::PCMEncoder(int bitsPerSample, size_t calibrationSamples)
+    : width(bitsPerSample), calibration(calibrationSamples) {
+    setRange(0.0, 0.0);
+    calibration = calibrationSamples;
+}
+
+void PCMEncoder::setRange(double minVal, double maxVal) {
+    pcmScale(width, minVal, maxVal, k);
+    calibration = 0;
+}
+
+size_t PCMEncoder::emit(const double* samples, size_t n, BitStream& bits) const {
+    size_t at = bits.size();
+    bits.resize(at + n * width);
+    quantizeInto(samples, n, k, width, bits.words.data(), at);
+    return n * width;
+}
+
+size_t PCMEncoder::push(const double* samples, size_t n, BitStream& bits) {
+    if (calibration == 0) return emit(samples, n, bits);
+
+    // Still calibrating: hold samples back until the range is known.
+    size_t take = min(n, calibration - pending.size());
+    pending.insert(pending.end(), samples, samples + take);
+    if (pending.size() < calibration) return 0;
+    return finish(bits) + emit(samples + take, n - take, bits);
+}
+
+size_t PCMEncoder::finish(BitStream& bits) {
+    if (calibration == 0 || pending.empty()) return 0;
+    double minVal = pending[0], maxVal = pending[0];
+    sampleRange(pending.data(), pending.size(), minVal, maxVal);
+    setRange(minVal, maxVal);
+    size_t k = emit(pending.data(), pending.size(), bits);
+    pending.clear();
+    return k;
+}
+
+size_t PCMEncoder::decode(BitView bits, double* analog) const {
+    double span = k[1] > 0.0 ? k[2] * (k[3] + 1) : 0.0;
+    return decodePCM(bits, width, k[0], k[0] + span, analog);
+}
+
+// G.711 companding. The encoders take 14-bit (mu-law) or 13-bit (A-law)
+// signed linear samples; the decoders return the segment midpoints in the
+// same units. Both follow the reference coder in the G.711 appendix.
+
+constexpr int muLawMax = 8191, aLawMax = 4095;
+
+static constexpr int g711Segment(int value, int firstEnd) {
+    int seg = 0;
+    for (int end = firstEnd; seg < 8 && value > end; end = end * 2 + 1) seg++;
+    return seg;
+}
+
+static constexpr int muLawEncode(int lin) {
+    int mask = 0xFF;
+    if (lin < 0) {
+        lin = -lin;
+        mask = 0x7F;
+    }
+    if (lin > 8159) lin = 8159;
+    lin += 0x84 >> 2;
+    int seg = g711Segment(lin, 0x3F);
+    if (seg >= 8) return 0x7F ^ mask;
+    return ((seg << 4) | ((lin >> (seg + 1)) & 0xF)) ^ mask;
+}
+
+static constexpr int muLawDecode(int code) {
+    code = ~code;
+    int t = (((code & 0x0F) << 3) + 0x84) << ((code & 0x70) >> 4);
+    return ((code & 0x80) ? 0x84 - t : t - 0x84) / 4;
+}
+
+static constexpr int aLawEncode(int lin) {
+    int mask = 0xD5;
+    if (lin < 0) {
+        lin = -lin - 1;
+        mask = 0x55;
+    }
+    int seg = g711Segment(lin, 0x1F);
+    if (seg >= 8) return 0x7F ^ mask;
+    int code = seg << 4;
+    code |= seg < 2 ? (lin >> 1) & 0xF : (lin >> seg) & 0xF;
+    return code ^ mask;
+}
+
+static constexpr int aLawDecode(int code) {
+    code ^= 0x55;
+    int t = (code & 0x0F) << 4;
+    int seg = (code & 0x70) >> 4;
+    if (seg == 0) t += 8;
+    else t = (t + 0x108) << (seg - 1);
+    return ((code & 0x80) ? t : -t) / 8;
+}
+
+static constexpr int reverseBits8(int b) {
+    int r = 0;
+    for (int i = 0; i < 8; i++) r |= ((b >> i) & 1) << (7 - i);
+    return r;
+}
+
+// Built by the compiler. Codes are stored bit-reversed, as they sit in a
+// packed stream sent MSB first, so a sample is encoded by one lookup and one
+// byte store, and a stream byte decodes by one lookup.
+struct G711Tables {
+    uint8_t muEncode[2 * (muLawMax + 1)];   // indexed by linear + 8192
+    uint8_t aEncode[2 * (aLawMax + 1)];     // indexed by linear + 4096
+    int16_t muDecode[256];                  // indexed by stream byte
+    int16_t aDecode[256];
+
+    constexpr G711Tables() : muEncode(), aEncode(), muDecode(), aDecode() {
+        for (int i = 0; i < 2 * (muLawMax + 1); i++) {
+            muEncode[i] = (uint8_t)reverseBits8(muLawEncode(i - muLawMax - 1));
+        }
+        for (int i = 0; i < 2 * (aLawMax + 1); i++) {
+            aEncode[i] = (uint8_t)reverseBits8(aLawEncode(i - aLawMax - 1));
+        }
+        for (int b = 0; b < 256; b++) {
+            muDecode[b] = (int16_t)muLawDecode(reverseBits8(b));
+            aDecode[b] = (int16_t)aLawDecode(reverseBits8(b));
+        }
+    }
+};
+
+static constexpr G711Tables g711;
+
+static_assert(g711.muEncode[muLawMax + 1] == reverseBits8(0xFF), "mu-law code for 0");
+static_assert(g711.aEncode[aLawMax + 1] == reverseBits8(0xD5), "A-law code for 0");
+
+size_t encodeCompanded(Companding law, const double* analog, size_t samples, BitStream& bits,
+                       double fullScale) {
+    bits.clear();
+    if (samples == 0) return 0;
+    if (fullScale <= 0.0) {
+        double lo = analog[0], hi = analog[0];
+        sampleRange(analog, samples, lo, hi);
+        fullScale = max(fabs(lo), fabs(hi));
+    }
+
+    bool mu = (law == COMPAND_MULAW);
+    double limit = mu ? muLawMax : aLawMax;
+    const uint8_t* table = mu ? g711.muEncode : g711.aEncode;
+    double scale = fullScale > 0.0 ? limit / fullScale : 0.0;
+
+    // Bits 8i..8i+7 of the stream are byte i of the little-endian words.
+    // The clip leaves no branch in the loop; it takes NaN to the lowest code,
+    // as the uniform quantiser does. Adding limit + 1.5 moves the table
+    // origin and rounds in one step.
+    bits.resize(samples * 8);
+    uint8_t* out = (uint8_t*)bits.words.data();
+    for (size_t i = 0; i < samples; i++) {
+        double v = max(-limit - 1.0, min(analog[i] * scale, limit));
+        out[i] = table[(int)(v + limit + 1.5)];
+    }
+    return bits.size();
+}
+
+size_t decodeCompanded(Companding law, BitView bits, double* analog, double fullScale) {
+    const int16_t* table = law == COMPAND_MULAW ? g711.muDecode : g711.aDecode;
+    double unit = fullScale / (law == COMPAND_MULAW ? muLawMax : aLawMax);
+    const uint8_t* in = (const uint8_t*)bits.words;
+    size_t samples = bits.size() / 8;
+    for (size_t i = 0; i < samples; i++) analog[i] = table[in[i]] * unit;
+    return samples;
+}
+
+size_t encodeDeltaMod(double* analog, size_t samples, BitStream& bits) {
+    double prediction = 0.0, delta = 0.5;
+    bits.clear();
+    for (size_t i = 0; i < samples; i++) {
+        if (analog[i] > prediction) {
+            bits.push(1);
+            prediction += delta;
+        } else {
+            bits.push(0);
+            prediction -= delta;
+        }
+    }
+    return bits.size();
+}
+
+size_t decodeDeltaMod(BitView bits, double* analog) {
+    double prediction = 0.0, delta = 0.5;
+    for (size_t i = 0; i < bits.size(); i++) {
+        prediction += bits.get(i) ? delta : -delta;
+        analog[i] = prediction;
+    }
+    return bits.size();
+}
+
+size_t decodePCM(BitView bits, int bitsPerSample, double minVal, double maxVal, double* analog) {
+    size_t samples = bits.size() / bitsPerSample;
+    double step = (maxVal - minVal) / ldexp(1.0, bitsPerSample);
+    for (size_t i = 0; i < samples; i++) {
+        int code = 0;
+        for (int j = 0; j < bitsPerSample; j++) code = (code << 1) | bits.get(i * bitsPerSample + j);
+        analog[i] = minVal + (code + 0.5) * step;
+    }
+    return samples;
+}
+
+size_t CVSDEncoder::push(const double* samples, size_t n, BitStream& bits) {
+    size_t at = bits.size();
+    bits.resize(at + n);
+    for (size_t i = 0; i < n; i++) {
+        int bit = samples[i] > estimate;
+        if (bit) bits.words[(at + i) >> 6] |= 1ULL << ((at + i) & 63);
+        advance(bit);
+    }
+    return n;
+}
+
+size_t CVSDDecoder::push(BitView bits, double* analog) {
+    for (size_t i = 0; i < bits.size(); i++) {
+        advance(bits.get(i));
+        analog[i] = estimate;
+    }
+    return bits.size();
+}
+
+double measureSQNR(const double* original, const double* decoded, size_t n) {
+    double signal = 0.0, noise = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double e = original[i] - decoded[i];
+        signal += original[i] * original[i];
+        noise += e * e;
+    }
+    return noise > 0.0 ? 10.0 * log10(signal / noise) : HUGE_VAL;
+}
+
+//ANALYTICAL:-
+
+size_t PalindromeTracker::runLength(size_t r) const {
+    if (lengths[r] != 255) return lengths[r];
+    return lower_bound(longRuns.begin(), longRuns.end(), make_pair(r, (size_t)0))->second;
+}
+
+// The block's earlier lengths are summed eight bytes at a time, then any
+// escaped ones are corrected from longRuns.
+size_t PalindromeTracker::runStart(size_t r) const {
+    if (r == runs) return finished;
+    const uint64_t bytes = 0x00FF00FF00FF00FFULL, ones = 0x0101010101010101ULL;
+    size_t base = r & ~(size_t)15, used = r & 15;
+    uint64_t half[2];
+    memcpy(half, &lengths[base], 16);
+    if (used < 8) {
+        half[0] &= (1ULL << (used * 8)) - 1;
+        half[1] = 0;
+    } else {
+        half[1] &= (1ULL << ((used - 8) * 8)) - 1;
+    }
+    uint64_t pairs = (half[0] & bytes) + ((half[0] >> 8) & bytes) + (half[1] & bytes) + ((half[1] >> 8) & bytes);
+    size_t at = blockStart[r >> 4] + (size_t)((pairs * 0x0001000100010001ULL) >> 48);
+    // A 255 byte is a zero byte of the complement.
+    uint64_t escaped = 0;
+    for (int h = 0; h < 2; h++) escaped |= (~half[h] - ones) & half[h] & (ones << 7);
+    if (escaped) {
+        for (size_t j = base; j < r; j++)
+            if (lengths[j] == 255) at += runLength(j) - 255;
+    }
+    return at;
+}
+
+void PalindromeTracker::closeRun(size_t length) {
+    if ((runs & 15) == 0) {
+        blockStart.push_back(finished);
+        lengths.resize(runs + 16);
+    }
+    if (length < 255) {
+        lengths[runs] = (uint8_t)length;
+    } else {
+        lengths[runs] = 255;
+        longRuns.push_back(make_pair(runs, length));
+    }
+    runs++;
+    finished += length;
+}
+
+// Bit j of the result is set where bit j of word differs from the bit before
+// it, `previous` being the bit before bit 0.
+static inline uint64_t bitChanges(uint64_t word, uint64_t previous) {
+    return word ^ ((word << 1) | previous);
+}
+
+void PalindromeTracker::push(BitView bits) {
+    size_t n = bits.size(), nWords = (n + 63) / 64;
+    if (n == 0) return;
+    if (finished + tail == 0) tailBit = bits.get(0);
+
+    // Count the runs first so the arrays grow once for a whole capture.
+    uint64_t previous = tailBit;
+    size_t closing = 0;
+    for (size_t w = 0; w < nWords; w++) {
+        uint64_t changes = bitChanges(bits.words[w], previous);
+        if (w == nWords - 1 && (n & 63)) changes &= (1ULL << (n & 63)) - 1;
+        closing += __builtin_popcountll(changes);
+        previous = bits.words[w] >> 63;
+    }
+    size_t want = runs + closing + 16;
+    if (want > lengths.capacity()) {
+        want = max(want, 2 * lengths.capacity());
+        lengths.reserve(want);
+        radius.reserve(want);
+        blockStart.reserve(want / 16 + 1);
+    }
+
+    previous = tailBit;
+    size_t from = 0;
+    for (size_t w = 0; w < nWords; w++) {
+        uint64_t changes = bitChanges(bits.words[w], previous);
+        if (w == nWords - 1 && (n & 63)) changes &= (1ULL << (n & 63)) - 1;
+        for (; changes; changes &= changes - 1) {
+            size_t at = w * 64 + __builtin_ctzll(changes);
+            closeRun(tail + at - from);
+            tail = 0;
+            from = at;
+        }
+        previous = bits.words[w] >> 63;
+    }
+    tail += n - from;
+    tailBit = bits.get(n - 1);
+    advance();
+}
+
+// Manacher's algorithm with run lengths as the symbols. A centre that has
+// matched up to the open run stops there until that run closes, since an
+// equal length would let it grow further.
+void PalindromeTracker::advance() {
+    size_t m = runs;
+    while (next < m) {
+        size_t i = next, k = reach;
+        while (k < i && i + k + 1 < m && lengths[i - k - 1] == lengths[i + k + 1] &&
+               (lengths[i - k - 1] != 255 || runLength(i - k - 1) == runLength(i + k + 1))) k++;
+        if (k < i && i + k + 1 == m && tail <= runLength(i - k - 1)) {
+            reach = k;
+            return;
+        }
+        radius.push_back((uint32_t)min(k, (size_t)UINT32_MAX));
+        if (i + k > right) {
+            center = i;
+            right = i + k;
+        }
+        // The runs either side of the matched ones share a bit value, so the
+        // palindrome takes as much of them as the shorter allows.
+        size_t edge = 0;
+        if (k < i) edge = min(runLength(i - k - 1), i + k + 1 < m ? runLength(i + k + 1) : tail);
+        size_t first = runStart(i - k);
+        size_t length = runStart(i + k + 1) - first + 2 * edge;
+        if (length > best.length) {
+            best.start = first - edge;
+            best.length = length;
+        }
+        next = i + 1;
+        reach = next < right ? min(right - next, (size_t)radius[2 * center - next]) : 0;
+    }
+}
+
+// The centre still waiting on the open run reaches the end of the stream,
+// so every centre after it is shorter; the stream is taken to end here.
+Palindrome PalindromeTracker::longest() const {
+    if (tail == 0) return best;
+    Palindrome open;
+    if (next == runs) {
+        open.start = finished;
+        open.length = tail;
+    } else {
+        size_t first = runStart(next - reach);
+        open.start = first - tail;
+        open.length = finished - first + 2 * tail;
+    }
+    return open.length > best.length ? open : best;
+}
+
+Palindrome findLongestPalindrome(BitView bits) {
+    PalindromeTracker tracker;
+    tracker.push(bits);
+    return tracker.longest();
+}
+
+void printPalindrome(ostream& out, BitView bits, const Palindrome& p) {
+    if (p.length == 0) return;
+    out << "\nLongest Palindrome: ";
+    for (size_t i = p.start; i < p.start + p.length; i++) out << bits.get(i);
+    out << " (Length: " << p.length << ")" << endl;
+}
+
+void printPalindrome(ostream& out, const Palindrome& p) {
+    if (p.length == 0) return;
+    out << "\nLongest Palindrome: bits " << p.start << " to " << p.start + p.length - 1
+        << " (Length: " << p.length << ")" << endl;
+}
+
+void printStats(ostream& out, const SignalStats& stats) {
+    if (stats.symbols == 0) return;
+    static const char* levelNames[3] = { "-1", "0", "+1" };
+    if (stats.longestRun[1] > 0)
+        out << "Longest zero sequence: " << stats.longestRun[1]
+            << " zeros starting at position " << stats.runStart[1] << endl;
+    out << "Longest runs:";
+    const char* separator = " ";
+    for (int l = 0; l < 3; l++) {
+        if (stats.longestRun[l] == 0) continue;
+        out << separator << levelNames[l] << " x" << stats.longestRun[l] << " at " << stats.runStart[l];
+        separator = ", ";
+    }
+    out << endl;
+    out << "Transitions: " << stats.transitions << " (" << stats.transitionDensity() << " per symbol)" << endl;
+    out << "Ones density: " << stats.onesDensity() << endl;
+    out << "Running DC: " << stats.dc << " at the end, " << stats.minDC << " to " << stats.maxDC
+        << " (DSV " << stats.sumVariation() << ")" << endl;
+    if (isBipolar(stats.code)) out << "Bipolar violations: " << stats.violations << endl;
+    else if (symbolsPerBit(stats.code) == 2) out << "Missing mid-bit transitions: " << stats.violations << endl;
+}
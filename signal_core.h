@@ -0,0 +1,533 @@
+#ifndef SIGNAL_CORE_H
+#define SIGNAL_CORE_H
+
+// Encoding, scrambling, modulation and analysis, shared by the interactive
+// generator and the benchmark. Nothing in here touches OpenGL.
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+// BIT STREAM :-
+
+// Read-only window onto packed bits owned elsewhere: a BitStream, a
+// word-aligned slice of one, or memory filled by another component.
+struct BitView {
+    const uint64_t* words;
+    size_t length;
+
+    BitView(const uint64_t* w, size_t n) : words(w), length(n) {}
+
+    size_t size() const { return length; }
+
+    int get(size_t i) const {
+        return (int)((words[i >> 6] >> (i & 63)) & 1);
+    }
+
+    // n bits starting at bit 64 * firstWord.
+    BitView slice(size_t firstWord, size_t n) const {
+        return BitView(words + firstWord, n);
+    }
+
+    // Position of the first bit equal to `bit` at or after i, or size() if
+    // there is none. Skips whole words of the other value.
+    size_t next(size_t i, int bit) const {
+        if (i >= length) return length;
+        uint64_t flip = bit ? 0 : ~0ULL;
+        size_t w = i >> 6;
+        uint64_t word = (words[w] ^ flip) >> (i & 63);
+        if (word) return clamp(i + __builtin_ctzll(word));
+        size_t nWords = (length + 63) >> 6;
+        for (w++; w < nWords; w++) {
+            word = words[w] ^ flip;
+            if (word) return clamp(w * 64 + __builtin_ctzll(word));
+        }
+        return length;
+    }
+
+private:
+    size_t clamp(size_t i) const { return i < length ? i : length; }
+};
+
+// Packed bits, 64 per word. Bit i lives in words[i / 64] at position i % 64.
+// Bits past length in the last word are always zero.
+struct BitStream {
+    std::vector<uint64_t> words;
+    size_t length;
+
+    BitStream() : length(0) {}
+
+    size_t size() const { return length; }
+
+    int get(size_t i) const {
+        return (int)((words[i >> 6] >> (i & 63)) & 1);
+    }
+
+    void set(size_t i, int bit) {
+        uint64_t mask = 1ULL << (i & 63);
+        if (bit) words[i >> 6] |= mask;
+        else words[i >> 6] &= ~mask;
+    }
+
+    void push(int bit) {
+        if ((length & 63) == 0) words.push_back(0);
+        if (bit) words[length >> 6] |= 1ULL << (length & 63);
+        length++;
+    }
+
+    void resize(size_t n) {
+        words.resize((n + 63) / 64, 0);
+        if (n < length && (n & 63)) words[n >> 6] &= (1ULL << (n & 63)) - 1;
+        length = n;
+    }
+
+    void clear() {
+        words.clear();
+        length = 0;
+    }
+
+    operator BitView() const { return BitView(words.data(), length); }
+};
+
+// Packed line symbols, each -1, 0 or +1: pos holds the +1s and neg the -1s,
+// one bit per symbol each. The binary-level codes never send a 0, so their
+// streams are not ternary, leave neg empty and read every clear pos bit as
+// -1, which is one bit per symbol instead of two.
+struct SymbolStream {
+    BitStream pos;
+    BitStream neg;
+    bool ternary;
+
+    SymbolStream() : ternary(false) {}
+
+    size_t size() const { return pos.size(); }
+
+    int get(size_t i) const {
+        if (pos.get(i)) return 1;
+        return (!ternary || neg.get(i)) ? -1 : 0;
+    }
+
+    void clear() {
+        pos.clear();
+        neg.clear();
+        ternary = false;
+    }
+};
+
+// Packs an ASCII '0'/'1' string; anything other than '1' is read as 0.
+size_t parseBits(const std::string& text, BitStream& bits);
+void printBits(BitView bits);
+
+// KERNELS :-
+
+// The bit expanders, sign splitters and PCM kernels, and the sine and FFT
+// kernels built on this, come in scalar, SSE2 and AVX2 versions, and start
+// out as the widest the CPU supports. setSimdLevel() switches them all to a
+// narrower set, so each version can be checked against the others on one
+// machine; it returns the level in use, which is never above cpuSimdLevel().
+// Not for use while encoding.
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2 };
+
+SimdLevel cpuSimdLevel();
+SimdLevel currentSimdLevel();
+SimdLevel setSimdLevel(SimdLevel level);
+
+// The version of a kernel for the level in use.
+template <class Kernel>
+inline Kernel pickKernel(Kernel avx2, Kernel sse2, Kernel scalar) {
+    SimdLevel level = currentSimdLevel();
+    if (level == SIMD_AVX2) return avx2;
+    if (level == SIMD_SSE2) return sse2;
+    return scalar;
+}
+
+// LINE CODING :-
+
+// Single-shot encoders. Manchester and Differential Manchester write two
+// symbols per bit, the rest one.
+void encodeNRZL(BitView bits, int* encoded);
+void encodeNRZI(BitView bits, int* encoded);
+void encodeManchester(BitView bits, int* encoded);
+void encodeDiffManchester(BitView bits, int* encoded);
+void encodeAMI(BitView bits, int* encoded);
+
+//STREAMING:-
+
+// Encoders fed one chunk at a time. The state each scheme carries from bit to
+// bit lives in the object, so the output of push() over any split of the input
+// followed by finish() is identical to a single-shot encode. B8ZS and HDB3
+// hold back a trailing run of zeros until they know whether it becomes a
+// substitution, so push() returns how many symbols it actually wrote.
+class StreamEncoder {
+public:
+    virtual ~StreamEncoder() {}
+    virtual int symbolsPerBit() const = 0;
+    virtual size_t push(BitView chunk, int* out) = 0;
+    virtual size_t finish(int* out) { (void)out; return 0; }
+
+    // Upper bound on symbols written by one push() or finish().
+    size_t maxOutput(size_t chunkBits) const {
+        return (chunkBits + 8) * symbolsPerBit();
+    }
+};
+
+class NRZLEncoder : public StreamEncoder {
+public:
+    int symbolsPerBit() const { return 1; }
+    size_t push(BitView chunk, int* out);
+};
+
+class NRZIEncoder : public StreamEncoder {
+    uint64_t carry;
+public:
+    NRZIEncoder(uint64_t parity = 0) : carry(parity) {}
+    int symbolsPerBit() const { return 1; }
+    size_t push(BitView chunk, int* out);
+};
+
+class ManchesterEncoder : public StreamEncoder {
+public:
+    int symbolsPerBit() const { return 2; }
+    size_t push(BitView chunk, int* out);
+};
+
+class DiffManchesterEncoder : public StreamEncoder {
+    uint64_t carry;
+public:
+    DiffManchesterEncoder(uint64_t parity = 0) : carry(parity) {}
+    int symbolsPerBit() const { return 2; }
+    size_t push(BitView chunk, int* out);
+};
+
+class AMIEncoder : public StreamEncoder {
+    int lastPolarity;
+public:
+    AMIEncoder(int polarity = 1) : lastPolarity(polarity) {}
+    int symbolsPerBit() const { return 1; }
+    size_t push(BitView chunk, int* out);
+};
+
+// Eight zeros become 000VB0VB, where V repeats the polarity of the last pulse.
+class B8ZSEncoder : public StreamEncoder {
+    int zeroCount;
+    bool flag;
+public:
+    // zeros: pending zeros already consumed but not yet written.
+    B8ZSEncoder(int zeros = 0, bool pulseHigh = true)
+        : zeroCount(zeros), flag(pulseHigh) {}
+    int symbolsPerBit() const { return 1; }
+    size_t push(BitView chunk, int* out);
+    size_t finish(int* out);
+};
+
+// Four zeros become B00V after an even number of pulses since the last
+// substitution, 000V after an odd number.
+class HDB3Encoder : public StreamEncoder {
+    int zeroCount;
+    bool flag;
+    bool prev;
+public:
+    // zeros: pending zeros already consumed but not yet written.
+    HDB3Encoder(int zeros = 0, bool evenPulses = true, bool lastHigh = false)
+        : zeroCount(zeros), flag(evenPulses), prev(lastHigh) {}
+    int symbolsPerBit() const { return 1; }
+    size_t push(BitView chunk, int* out);
+    size_t finish(int* out);
+};
+
+enum LineCode {
+    LINE_NRZL,
+    LINE_NRZI,
+    LINE_MANCHESTER,
+    LINE_DIFF_MANCHESTER,
+    LINE_AMI,
+    LINE_B8ZS,
+    LINE_HDB3,
+    LINE_MLT3
+};
+
+const int lineCodeCount = LINE_MLT3 + 1;
+
+// Each code's traits come from its policy in signal_codes.h.
+int symbolsPerBit(LineCode code);
+// AMI, its scrambled forms and MLT-3 use all three levels.
+bool isTernary(LineCode code);
+// AMI and its scrambled forms, whose marks alternate in polarity.
+bool isBipolar(LineCode code);
+StreamEncoder* makeEncoder(LineCode code);
+
+// Reads ASCII bits from `in` (whitespace skipped) and writes space-separated
+// symbols to `out`, holding one chunk of each in memory. Returns the number
+// of symbols written.
+size_t encodeStream(std::istream& in, std::ostream& out, StreamEncoder& encoder);
+
+//SCRAMBLING:-
+
+void scrambleB8ZS(BitView bits, int* encoded);
+void scrambleHDB3(BitView bits, int* encoded);
+
+//PARALLEL:-
+
+// Same output as the single-shot encoder for `code`; threads = 0 uses every core.
+void encodeParallel(LineCode code, BitView bits, int* encoded, unsigned threads = 0);
+
+//DECODING:-
+
+// n is the symbol count. Each returns the number of code violations.
+size_t decodeNRZL(const int* symbols, size_t n, BitStream& bits);
+size_t decodeNRZI(const int* symbols, size_t n, BitStream& bits);
+size_t decodeManchester(const int* symbols, size_t n, BitStream& bits);
+size_t decodeDiffManchester(const int* symbols, size_t n, BitStream& bits);
+size_t decodeAMI(const int* symbols, size_t n, BitStream& bits);
+size_t descrambleB8ZS(const int* symbols, size_t n, BitStream& bits);
+size_t descrambleHDB3(const int* symbols, size_t n, BitStream& bits);
+size_t decodeSignal(LineCode code, const int* symbols, size_t n, BitStream& bits);
+
+//PACKED SYMBOLS:-
+
+// Line statistics gathered while encodeSymbols() writes the planes, so the
+// symbols are never walked a second time. A run is a maximal stretch of one
+// level; longestRun and runStart are indexed by level + 1.
+struct SignalStats {
+    LineCode code;
+    size_t bits, ones;              // of the input
+    size_t symbols;
+    size_t transitions;             // symbols that differ from the one before
+    size_t longestRun[3];
+    size_t runStart[3];             // first symbol of the earliest longest run
+    long long dc, minDC, maxDC;     // running digital sum: final, lowest, highest
+    // Ternary codes: pulses with the same polarity as the pulse before them,
+    // two per B8ZS substitution and one per HDB3. Manchester codes: bits with
+    // no mid-bit transition. Zero otherwise.
+    size_t violations;
+
+    SignalStats()
+        : code(LINE_NRZL), bits(0), ones(0), symbols(0), transitions(0),
+          dc(0), minDC(0), maxDC(0), violations(0) {
+        for (int l = 0; l < 3; l++) longestRun[l] = runStart[l] = 0;
+    }
+
+    double onesDensity() const { return bits ? (double)ones / bits : 0.0; }
+    double transitionDensity() const { return symbols > 1 ? (double)transitions / (symbols - 1) : 0.0; }
+    // Digital sum variation: the spread of the running sum.
+    long long sumVariation() const { return maxDC - minDC; }
+};
+
+class StatsScanner;
+
+// The same statistics for bits and int symbols that arrive a block at a
+// time, as from a StreamEncoder. Symbols are packed a word at a time into a
+// small buffer and scanned there; under a word is carried between calls.
+class StatsTracker {
+public:
+    StatsTracker(LineCode code, SignalStats& stats);
+    ~StatsTracker();
+
+    void pushBits(BitView bits);
+    void pushSymbols(const int* symbols, size_t n);
+    void finish();
+
+private:
+    SignalStats& stats;
+    StatsScanner* scanner;
+    int pending[64];
+    size_t held;
+
+    void scan(const int* symbols, size_t n);
+    StatsTracker(const StatsTracker&);
+    StatsTracker& operator=(const StatsTracker&);
+};
+
+// Same symbols as the int encoders, written straight into the bit planes.
+// With stats, the planes are summarised a block at a time as they are made.
+void encodeSymbols(LineCode code, BitView bits, SymbolStream& symbols, SignalStats* stats = NULL);
+void packSymbols(const int* symbols, size_t n, bool ternary, SymbolStream& packed);
+// Packs symbols onto the end of packed, whose ternary flag is already set.
+void appendSymbols(const int* symbols, size_t n, SymbolStream& packed);
+// Writes symbols first .. first + n - 1 of `packed` as ints.
+void unpackSymbols(const SymbolStream& packed, size_t first, size_t n, int* out);
+size_t decodeSignal(LineCode code, const SymbolStream& symbols, BitStream& bits);
+
+// Levels and transitions seen over a range of symbols.
+struct SymbolSummary {
+    int lo, hi;
+    uint64_t transitions;   // i in the range, past its first symbol, with s[i] != s[i-1]
+};
+
+// Min/max/transition counts over a SymbolStream for blocks of 64, 128,
+// 256... symbols, so any range is summarised in O(log n) steps however long
+// it is. The stream must outlive the pyramid and stay unchanged.
+class SymbolPyramid {
+public:
+    SymbolPyramid() : symbols(NULL) {}
+
+    void build(const SymbolStream& stream);
+    // n > 0 and first + n <= size of the stream.
+    SymbolSummary summarize(size_t first, size_t n) const;
+
+private:
+    struct Node {
+        int8_t lo, hi;
+        uint32_t changes;   // symbols in the block that differ from the one before
+    };
+    const SymbolStream* symbols;
+    std::vector<std::vector<Node> > levels;
+
+    Node wordNode(size_t w, uint64_t valid) const;
+};
+
+//MODULATION:-
+
+// PCM over the whole input: the range is the samples' own min/max, so every
+// sample is seen twice. Codes are bitsPerSample wide, MSB first; threads = 0
+// uses every core.
+size_t encodePCM(const double* analog, size_t samples, BitStream& bits, int bitsPerSample,
+                 unsigned threads = 0);
+
+// PCM for streams. The range is either fixed up front or calibrated from the
+// first samples, which are held back until that many have arrived. Samples
+// outside the range clip to the lowest or highest code. push() and finish()
+// append to bits and return how many bits they added.
+class PCMEncoder {
+public:
+    PCMEncoder(int bitsPerSample, double minVal, double maxVal);
+    PCMEncoder(int bitsPerSample, size_t calibrationSamples);
+
+    size_t push(const double* samples, size_t n, BitStream& bits);
+    // Calibrates on what has arrived if the stream ended early.
+    size_t finish(BitStream& bits);
+    // decodePCM() over the range in use; writes bits.size() / bitsPerSample samples.
+    size_t decode(BitView bits, double* analog) const;
+
+private:
+    int width;
+    size_t calibration;     // samples to calibrate on, 0 once the range is set
+    std::vector<double> pending;
+    double k[4];            // lo, scale, step, top
+
+    void setRange(double minVal, double maxVal);
+    size_t emit(const double* samples, size_t n, BitStream& bits) const;
+};
+// G.711 companded PCM: 8-bit codes, MSB first, from lookup tables the
+// compiler builds. fullScale is the amplitude given the largest code; 0 uses
+// the peak of the samples. Decoding writes bits.size() / 8 samples.
+enum Companding { COMPAND_MULAW, COMPAND_ALAW };
+
+size_t encodeCompanded(Companding law, const double* analog, size_t samples, BitStream& bits,
+                       double fullScale = 0.0);
+size_t decodeCompanded(Companding law, BitView bits, double* analog, double fullScale);
+
+// Midpoint of each code's step in [minVal, maxVal]; writes bits.size() /
+// bitsPerSample samples.
+size_t decodePCM(BitView bits, int bitsPerSample, double minVal, double maxVal, double* analog);
+
+size_t encodeDeltaMod(double* analog, size_t samples, BitStream& bits);
+size_t decodeDeltaMod(BitView bits, double* analog);
+
+// Continuously variable slope delta modulation. A run of `run` equal bits
+// means the estimate is falling behind, so the step grows by `growth`; any
+// other bit shrinks it by `decay`. The step stays within [minStep, maxStep].
+struct CVSDParams {
+    int run;
+    double minStep, maxStep;
+    double growth, decay;
+
+    CVSDParams() : run(3), minStep(0.01), maxStep(1.0), growth(1.5), decay(0.9) {}
+};
+
+// The estimate both ends track. The encoder and decoder apply the same
+// update per bit, so the decoder's output is the encoder's estimate.
+class CVSDTracker {
+public:
+    CVSDTracker(const CVSDParams& p) : params(p), estimate(0.0), step(p.minStep), last(-1), run(0) {}
+
+protected:
+    CVSDParams params;
+    double estimate, step;
+    int last, run;
+
+    void advance(int bit) {
+        run = (bit == last) ? run + 1 : 1;
+        last = bit;
+        if (run >= params.run) step = std::min(step * params.growth, params.maxStep);
+        else step = std::max(step * params.decay, params.minStep);
+        estimate += bit ? step : -step;
+    }
+};
+
+// Both carry their state across push() calls, so a stream can be coded in
+// chunks of any size.
+class CVSDEncoder : public CVSDTracker {
+public:
+    CVSDEncoder(const CVSDParams& p = CVSDParams()) : CVSDTracker(p) {}
+    // Appends one bit per sample; returns n.
+    size_t push(const double* samples, size_t n, BitStream& bits);
+};
+
+class CVSDDecoder : public CVSDTracker {
+public:
+    CVSDDecoder(const CVSDParams& p = CVSDParams()) : CVSDTracker(p) {}
+    // Writes one sample per bit; returns bits.size().
+    size_t push(BitView bits, double* analog);
+};
+
+// Signal-to-quantisation-noise ratio of decoded against original, in dB.
+double measureSQNR(const double* original, const double* decoded, size_t n);
+
+//ANALYTICAL:-
+
+// Bits [start, start + length) read the same in both directions.
+struct Palindrome {
+    size_t start, length;
+
+    Palindrome() : start(0), length(0) {}
+};
+
+// Longest palindrome of a stream that arrives in chunks; the leftmost one on
+// ties. A palindrome that is not inside a single run of equal bits has to be
+// centred on the middle of a run, so this is Manacher's algorithm over the
+// run lengths instead of the bits: no separator transform, one radius per
+// run, and the bits themselves are not kept. That is about 5.5 bytes per run,
+// under 3 per bit for random data and never more than 5.5.
+class PalindromeTracker {
+public:
+    PalindromeTracker()
+        : runs(0), finished(0), tail(0), tailBit(0), center(0), right(0), next(0), reach(0) {}
+
+    void push(BitView bits);
+    // Longest palindrome in everything pushed so far.
+    Palindrome longest() const;
+
+private:
+    // Closed runs, in blocks of 16: a byte per length, 255 meaning the
+    // length is in longRuns, and the first bit of each block.
+    std::vector<uint8_t> lengths;
+    std::vector<std::pair<size_t, size_t> > longRuns; // run index, length
+    std::vector<size_t> blockStart;
+    std::vector<uint32_t> radius;                    // runs matched each side, saturating
+    size_t runs;                                     // closed runs
+    size_t finished;                                 // bits in closed runs
+    size_t tail;                                     // bits in the open run
+    int tailBit;
+    // Manacher state: the palindrome reaching furthest right is centred on
+    // run `center` and ends at run `right`; run `next` has matched `reach`
+    // runs so far and waits on the open run to go further.
+    size_t center, right, next, reach;
+    Palindrome best;
+
+    size_t runLength(size_t r) const;
+    size_t runStart(size_t r) const;
+    void closeRun(size_t length);
+    void advance();
+};
+
+Palindrome findLongestPalindrome(BitView bits);
+void printPalindrome(std::ostream& out, BitView bits, const Palindrome& p);
+// Position and length only, for bits that were streamed and not kept.
+void printPalindrome(std::ostream& out, const Palindrome& p);
+void printStats(std::ostream& out, const SignalStats& stats);
+
+#endif
@@ -1,534 +1,976 @@
 #include <iostream>
+#include <fstream>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
 #include <cmath>
 #include <algorithm>
-#include <cstdio>
+#include <string>
+#include <vector>
+#include "signal_core.h"
+#include "signal_codes.h"
+#include "signal_io.h"
+#include "signal_render.h"
+#include "signal_source.h"
+#include "signal_spectrum.h"
+#include "signal_pipeline.h"
+#include "signal_live.h"
+// Build with -DSIGNAL_HEADLESS for batch nodes: no window, no freeglut.
+#ifndef SIGNAL_HEADLESS
 #include "GL/glut.h"
+#include "GL/freeglut_ext.h"
+#endif
 using namespace std;
 
+#ifndef SIGNAL_HEADLESS
 // Global variables
-int* currentSignal = NULL;
-int signalLength = 0;
+const SymbolStream* currentSignal = NULL;
+SymbolPyramid signalPyramid;
+size_t signalLength = 0;
 char signalTitle[100] = "";
 bool isManchester = false;
+int windowWidth = 1200;
+
+// The visible symbols, [viewFirst, viewFirst + viewSpan), fill x in
+// [-0.9, 0.9]. Fractional ends keep panning smooth when zoomed in.
+double viewFirst = 0.0, viewSpan = 1.0;
+int dragX = -1;
+double dragFirst = 0.0;
+
+// Everything on screen is rebuilt only when the signal, the view or the
+// window width changes. The trace geometry is x, y pairs, kept in a vertex
+// buffer when the driver has them; the axes, grid and labels are recorded
+// into two display lists, one drawn under the trace and one over it.
+vector<float> traceVertices;
+GLsizei traceCount = 0;
+GLenum traceMode = GL_LINE_STRIP;
+GLuint traceBuffer = 0;
+GLuint sceneLists = 0;
+bool sceneDirty = true;
+
+// One display list per ASCII glyph and font, so a label is one
+// glCallLists() rather than a glutBitmapCharacter() per character.
+GLuint textGlyphs = 0, boldGlyphs = 0;
+
+// Live mode: the encoder thread's frames are drained into liveHistory on
+// the idle callback and the newest liveSpan symbols are plotted, so each
+// symbol is copied once on arrival and a redraw costs O(liveSpan).
+LiveRing* liveRing = NULL;
+LiveEncoder* liveEncoder = NULL;
+LiveHistory* liveHistory = NULL;
+SymbolStream liveWindow;
+size_t liveSpan = 512;
+bool liveTernary = false, liveEnded = false;
+
+// Buffer objects are OpenGL 1.5, past what opengl32.lib exports on Windows,
+// so they are looked up at run time. Without them the trace is drawn from
+// a client-side vertex array instead.
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_DYNAMIC_DRAW 0x88E8
+#endif
+typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+GenBuffersProc genBuffers = NULL;
+BindBufferProc bindBuffer = NULL;
+BufferDataProc bufferData = NULL;
 
-// LINE CODING :-
-
-void encodeNRZL(char* bits, int* encoded, int n) {
-    for (int i = 0; i < n; i++) {
-        encoded[i] = (bits[i] == '1') ? 1 : -1;
+//OPENGL:-
+GLuint buildGlyphs(void* font) {
+    GLuint base = glGenLists(128);
+    for (int c = 32; c < 127; c++) {
+        glNewList(base + c, GL_COMPILE);
+        glutBitmapCharacter(font, c);
+        glEndList();
     }
+    return base;
 }
 
-void encodeNRZI(char* bits, int* encoded, int n) {
-    int level = -1;
-    for (int i = 0; i < n; i++) {
-        if (bits[i] == '1') level = -level;
-        encoded[i] = level;
-    }
-}
 
-void encodeManchester(char* bits, int* encoded, int n) {
-    for (int i = 0; i < n; i++) {
-        if (bits[i] == '0') {
-            encoded[2*i] = 1;
-            encoded[2*i + 1] = -1;
-        } else {
-            encoded[2*i] = -1;
-            encoded[2*i + 1] = 1;
-        }
-    }
+void drawText(float x, float y, const char* text) {
+    glRasterPos2f(x, y);
+    glListBase(textGlyphs);
+    glCallLists((GLsizei)strlen(text), GL_UNSIGNED_BYTE, text);
 }
 
-void encodeDiffManchester(char* bits, int* encoded, int n) {
-    int prevLevel = -1;
-    for (int i = 0; i < n; i++) {
-        if (bits[i] == '0') {
-            prevLevel = -prevLevel;
-            encoded[2*i] = prevLevel;
-            encoded[2*i + 1] = -prevLevel;
-        } else {
-            encoded[2*i] = prevLevel;
-            encoded[2*i + 1] = -prevLevel;
-        }
-        prevLevel = -prevLevel;
-    }
+
+void drawBoldText(float x, float y, const char* text) {
+    glRasterPos2f(x, y);
+    glListBase(boldGlyphs);
+    glCallLists((GLsizei)strlen(text), GL_UNSIGNED_BYTE, text);
 }
 
-void encodeAMI(char* bits, int* encoded, int n) {
-    int lastPolarity = 1;
-    for (int i = 0; i < n; i++) {
-        if (bits[i] == '0') encoded[i] = 0;
-        else {
-            encoded[i] = lastPolarity;
-            lastPolarity = -lastPolarity;
-        }
+
+// The shared plot layout, drawn with GL calls.
+class GLCanvas : public Canvas {
+public:
+    void color(float r, float g, float b) { glColor3f(r, g, b); }
+    void lineWidth(float width) { glLineWidth(width); }
+    void line(float x0, float y0, float x1, float y1) {
+        glBegin(GL_LINES);
+            glVertex2f(x0, y0);
+            glVertex2f(x1, y1);
+        glEnd();
+    }
+    void text(float x, float y, const char* str, bool bold) {
+        if (bold) drawBoldText(x, y, str);
+        else drawText(x, y, str);
     }
+};
+
+
+// Plot width in pixels: x in [-0.9, 0.9] of the window.
+int plotColumns() {
+    return max(1, (int)(windowWidth * 0.9f));
 }
 
-//SCRAMBLING:-
-
-// --- B8ZS Scrambling ---
-void scrambleB8ZS(char* bits, int* encoded, int n) {
-    int zeroCount = 0;
-    bool flag = true;  
-    
-    for (int i = 0; i < n; i++) {
-        if (bits[i] == '1') {
-            encoded[i] = flag ? 1 : -1;
-            zeroCount = 0;
-            flag = !flag;
-        } else {
-            encoded[i] = 0;
-            zeroCount++;
-        }
-        
-        
-        if (zeroCount == 8) {
-        
-            encoded[i-4] = flag ? -1 : 1;   
-            encoded[i-3] = flag ? 1 : -1;   
-            encoded[i-1] = flag ? 1 : -1;   
-            encoded[i] = flag ? -1 : 1;     
-            zeroCount = 0;
-        }
-    }
+PlotView currentView() {
+    PlotView view = { currentSignal, &signalPyramid, signalTitle, isManchester,
+                      viewFirst, viewSpan, plotColumns() };
+    return view;
 }
 
-// HDB3 - 
-void scrambleHDB3(char* bits, int* encoded, int n) {
-    int zeroCount = 0;
-    bool flag = true;      
-    bool prev = false;     
-    
-    for (int i = 0; i < n; i++) {
-        if (bits[i] == '1') {
-            encoded[i] = prev ? -1 : 1;
-            zeroCount = 0;
-            flag = !flag;
-            prev = !prev;
-        } else {
-            encoded[i] = 0;
-            zeroCount++;
-        }
-        
-        
-        if (zeroCount == 4) {
-            if (flag) {
-                
-                encoded[i-3] = prev ? -1 : 1;   
-                encoded[i] = prev ? -1 : 1;     
-            } else {
-            
-                encoded[i] = prev ? 1 : -1;     
-            }
-            zeroCount = 0;
-            flag = true;
-            prev = (encoded[i] > 0);
-        }
+
+// Rebuilds the trace buffer and records the axes, grid and labels for the
+// current view.
+void buildScene() {
+    PlotView view = currentView();
+    bool strip;
+    buildPlotTrace(view, traceVertices, strip);
+    traceMode = strip ? GL_LINE_STRIP : GL_LINES;
+    traceCount = (GLsizei)(traceVertices.size() / 2);
+    if (genBuffers) {
+        if (!traceBuffer) genBuffers(1, &traceBuffer);
+        bindBuffer(GL_ARRAY_BUFFER, traceBuffer);
+        bufferData(GL_ARRAY_BUFFER, traceVertices.size() * sizeof(float), traceVertices.data(), GL_DYNAMIC_DRAW);
+        bindBuffer(GL_ARRAY_BUFFER, 0);
     }
-}
 
+    GLCanvas canvas;
+    if (!sceneLists) sceneLists = glGenLists(2);
+    glNewList(sceneLists, GL_COMPILE);
+    drawPlotBackground(canvas, view);
+    glEndList();
+    glNewList(sceneLists + 1, GL_COMPILE);
+    drawPlotValues(canvas, view);
+    glEndList();
+}
 
 
+// Rate, position, latency and drops, redrawn every frame in live mode.
+void drawLiveOverlay() {
+    char line[160];
+    unsigned long long end = liveHistory->streamEnd();
+    snprintf(line, sizeof(line), "%g symbols/s, symbols %llu-%llu%s", liveEncoder->rate(),
+             end - liveWindow.size(), end, liveEnded ? " (ended)" : "");
+    glColor3f(0.3f, 0.3f, 0.3f);
+    drawText(0.3f, 0.92f, line);
+    snprintf(line, sizeof(line), "Latency %.1f ms (mean %.1f, max %.1f), dropped %llu of %llu frames",
+             liveHistory->lastLatency(), liveHistory->meanLatency(), liveHistory->maxLatency(),
+             (unsigned long long)liveEncoder->dropped(),
+             (unsigned long long)(liveEncoder->dropped() + liveEncoder->produced()));
+    drawText(0.3f, 0.86f, line);
+}
 
-//MODULATION:-
+void display() {
+    glClear(GL_COLOR_BUFFER_BIT);
 
-int encodePCM(double* analog, int samples, char* bits, int bitsPerSample) {
-    double maxVal = analog[0], minVal = analog[0];
-    for (int i = 1; i < samples; i++) {
-        if (analog[i] > maxVal) maxVal = analog[i];
-        if (analog[i] < minVal) minVal = analog[i];
+    if (currentSignal == NULL || signalLength == 0) {
+        glutSwapBuffers();
+        return;
+    }
+    if (sceneDirty) {
+        buildScene();
+        sceneDirty = false;
     }
 
-    int levels = pow(2, bitsPerSample);
-    double step = (maxVal - minVal) / levels;
-    int bitIndex = 0;
-
-    for (int i = 0; i < samples; i++) {
-        int quantized = (int)((analog[i] - minVal) / step);
-        if (quantized >= levels) quantized = levels - 1;
+    glCallList(sceneLists);
 
-        for (int j = bitsPerSample - 1; j >= 0; j--) {
-            bits[bitIndex++] = ((quantized >> j) & 1) ? '1' : '0';
-        }
+    // Draw signal line
+    glColor3f(0.0, 0.0, 1.0);
+    glLineWidth(3.0f);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    if (traceBuffer) {
+        bindBuffer(GL_ARRAY_BUFFER, traceBuffer);
+        glVertexPointer(2, GL_FLOAT, 0, NULL);
+    } else {
+        glVertexPointer(2, GL_FLOAT, 0, traceVertices.data());
     }
-    bits[bitIndex] = '\0';
-    return bitIndex;
+    glDrawArrays(traceMode, 0, traceCount);
+    if (traceBuffer) bindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glCallList(sceneLists + 1);
+    if (liveHistory) drawLiveOverlay();
+    glutSwapBuffers();
+    if (liveHistory) liveHistory->shown(liveClock());
 }
 
-int encodeDeltaMod(double* analog, int samples, char* bits) {
-    double prediction = 0.0, delta = 0.5;
-    for (int i = 0; i < samples; i++) {
-        if (analog[i] > prediction) {
-            bits[i] = '1';
-            prediction += delta;
-        } else {
-            bits[i] = '0';
-            prediction -= delta;
-        }
+
+void reshape(int width, int height) {
+    glViewport(0, 0, width, height);
+    if (width != windowWidth) {
+        windowWidth = width;
+        sceneDirty = true;
     }
-    bits[samples] = '\0';
-    return samples;
 }
 
-//ANALYTICAL:-
-
-void findLongestPalindrome(char* str, int n) {
-    int maxLen = 1, start = 0;
-    char* temp = new char[2 * n + 3];
-    int tLen = 0;
-    temp[tLen++] = '^';
-    for (int i = 0; i < n; i++) {
-        temp[tLen++] = '|';
-        temp[tLen++] = str[i];
-    }
-    temp[tLen++] = '|';
-    temp[tLen++] = '$';
-
-    int* p = new int[tLen];
-    for (int i = 0; i < tLen; i++) p[i] = 0;
-    int center = 0, right = 0;
-
-    for (int i = 1; i < tLen - 1; i++) {
-        int mirror = 2 * center - i;
-        if (i < right) p[i] = min(right - i, p[mirror]);
-        while (temp[i + p[i] + 1] == temp[i - p[i] - 1]) p[i]++;
-        if (i + p[i] > right) {
-            center = i;
-            right = i + p[i];
-        }
-        if (p[i] > maxLen) {
-            maxLen = p[i];
-            start = (i - p[i]) / 2;
-        }
-    }
+//VIEW:-
 
-    cout << "\nLongest Palindrome: ";
-    for (int i = start; i < start + maxLen; i++) cout << str[i];
-    cout << " (Length: " << maxLen << ")" << endl;
+// Zoomed all the way in, a few symbols still fill the plot.
+void clampView() {
+    double minSpan = min(4.0, (double)signalLength);
+    viewSpan = max(minSpan, min(viewSpan, (double)signalLength));
+    viewFirst = max(0.0, min(viewFirst, (double)signalLength - viewSpan));
+    sceneDirty = true;
+    glutPostRedisplay();
+}
 
-    delete[] temp;
-    delete[] p;
+// Scales the view by factor, keeping the symbol under pixel column x fixed.
+void zoomAt(int x, double factor) {
+    double along = (x - windowWidth * 0.05) / plotColumns();
+    along = max(0.0, min(1.0, along));
+    double anchor = viewFirst + along * viewSpan;
+    viewSpan *= factor;
+    viewFirst = anchor - along * viewSpan;
+    clampView();
 }
 
-void findLongestZeroRun(int* signal, int n) {
-    int maxCount = 0, count = 0, maxStart = 0, currStart = 0;
-    for (int i = 0; i < n; i++) {
-        if (signal[i] == 0) {
-            if (count == 0) currStart = i;
-            count++;
-        } else {
-            if (count > maxCount) {
-                maxCount = count;
-                maxStart = currStart;
-            }
-            count = 0;
-        }
+// Wheel up/down arrive as buttons 3 and 4; the left button drags.
+void mouse(int button, int state, int x, int y) {
+    (void)y;
+    if (button == 3 && state == GLUT_DOWN) zoomAt(x, 0.8);
+    else if (button == 4 && state == GLUT_DOWN) zoomAt(x, 1.25);
+    else if (button == GLUT_LEFT_BUTTON) {
+        dragX = state == GLUT_DOWN ? x : -1;
+        dragFirst = viewFirst;
     }
-    if (count > maxCount) maxCount = count;
-    if (maxCount > 0)
-        cout << "Longest zero sequence: " << maxCount
-             << " zeros starting at position " << maxStart << endl;
 }
 
-//OPENGL:-
-void drawText(float x, float y, const char* text) {
-    glRasterPos2f(x, y);
-    for (int i = 0; text[i] != '\0'; i++) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, text[i]);
+void motion(int x, int y) {
+    (void)y;
+    if (dragX < 0) return;
+    viewFirst = dragFirst - (x - dragX) * viewSpan / plotColumns();
+    clampView();
+}
+
+// '+' and '-' zoom about the centre, '0' shows the whole signal again.
+void keyboard(unsigned char key, int x, int y) {
+    (void)x;
+    (void)y;
+    if (key == '+' || key == '=') zoomAt(windowWidth / 2, 0.5);
+    else if (key == '-') zoomAt(windowWidth / 2, 2.0);
+    else if (key == '0') {
+        viewFirst = 0.0;
+        viewSpan = (double)signalLength;
+        clampView();
     }
 }
 
 
-void drawBoldText(float x, float y, const char* text) {
-    glRasterPos2f(x, y);
-    for (int i = 0; text[i] != '\0'; i++) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, text[i]);
-    }
+void initializeGL() {
+    glClearColor(1.0, 1.0, 1.0, 1.0);
+    genBuffers = (GenBuffersProc)glutGetProcAddress("glGenBuffers");
+    bindBuffer = (BindBufferProc)glutGetProcAddress("glBindBuffer");
+    bufferData = (BufferDataProc)glutGetProcAddress("glBufferData");
+    if (!genBuffers || !bindBuffer || !bufferData) genBuffers = NULL;
+    textGlyphs = buildGlyphs(GLUT_BITMAP_HELVETICA_12);
+    boldGlyphs = buildGlyphs(GLUT_BITMAP_HELVETICA_18);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluOrtho2D(-1.0, 1.0, -1.0, 1.0);
 }
 
 
-void display() {
-    glClear(GL_COLOR_BUFFER_BIT);
+void showSignal(const SymbolStream& signal, const char* title, bool manchester) {
+    currentSignal = &signal;
+    signalLength = signal.size();
+    signalPyramid.build(signal);
+    strcpy(signalTitle, title);
+    isManchester = manchester;
+    viewFirst = 0.0;
+    viewSpan = max(1.0, (double)signalLength);
+    sceneDirty = true;
+    glutPostRedisplay();
+}
 
-    if (currentSignal == nullptr || signalLength == 0) {
-        glFlush();
+//LIVE:-
+
+// Plots the newest liveSpan symbols.
+void refreshLive() {
+    liveHistory->window(liveSpan, liveTernary, liveWindow);
+    currentSignal = &liveWindow;
+    signalLength = liveWindow.size();
+    signalPyramid.build(liveWindow);
+    viewFirst = 0.0;
+    viewSpan = max(1.0, (double)signalLength);
+    sceneDirty = true;
+    glutPostRedisplay();
+}
+
+void liveIdle() {
+    if (liveHistory->drain(*liveRing)) {
+        refreshLive();
         return;
     }
+    if (!liveEnded && liveEncoder->finished()) {
+        liveEnded = true;
+        glutPostRedisplay();
+    }
+    // Nothing new: give the core back instead of spinning.
+    this_thread::sleep_for(chrono::milliseconds(1));
+}
+
+// '+' and '-' halve and double the symbols in view.
+void liveKeyboard(unsigned char key, int x, int y) {
+    (void)x;
+    (void)y;
+    if (key == '+' || key == '=') liveSpan = max((size_t)16, liveSpan / 2);
+    else if (key == '-') liveSpan = min(liveHistory->capacity(), liveSpan * 2);
+    else return;
+    refreshLive();
+}
+
+// Opens the window and scrolls source across it at rate symbols per second
+// until the window is closed.
+int runLive(BitSource& source, LineCode code, double rate, int argc, char** argv) {
+    glutInit(&argc, argv);
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+    glutInitWindowSize(1200, 700);
+    glutInitWindowPosition(50, 50);
+    glutCreateWindow("Digital Signal Oscilloscope");
+    initializeGL();
+
+    // About four seconds of frames, however fast the symbols come.
+    LiveRing ring((size_t)max(16.0, min(4.0 * rate / liveFrameSymbols(rate), 65536.0)));
+    LiveHistory history(1 << 16);
+    LiveEncoder encoder(source, code, rate, ring);
+    liveRing = &ring;
+    liveHistory = &history;
+    liveEncoder = &encoder;
+    liveTernary = isTernary(code);
+    strcpy(signalTitle, codeTitle(code));
+    isManchester = symbolsPerBit(code) == 2;
+
+    glutDisplayFunc(display);
+    glutReshapeFunc(reshape);
+    glutKeyboardFunc(liveKeyboard);
+    glutIdleFunc(liveIdle);
+    encoder.start();
+    cerr << "Live at " << rate << " symbols/s (+/-: zoom). Close the window to stop." << endl;
+    glutMainLoop();
+    encoder.stop();
+
+    fprintf(stderr, "%llu frames, %llu dropped; latency mean %.2f ms, max %.2f ms\n",
+            (unsigned long long)encoder.produced(), (unsigned long long)encoder.dropped(),
+            history.meanLatency(), history.maxLatency());
+    liveRing = NULL;
+    liveHistory = NULL;
+    liveEncoder = NULL;
+    currentSignal = NULL;
+    return 0;
+}
+#endif
+
+//COMMAND LINE:-
+
+void printUsage() {
+    cerr << "Usage: signal_generator [--scheme S] [--scramble S] [--mod M] [--bits N]\n"
+            "                        [--in PATH] [--out PATH] [--in-format F]\n"
+            "                        [--out-format F] [--range MIN:MAX | --calibrate N]\n"
+            "                        [--step MIN:MAX] [--run N] [--growth G]\n"
+            "                        [--decay D] [--source WAVE]\n"
+            "                        [--rate HZ] [--duration S] [--freq HZ]\n"
+            "                        [--freq-end HZ] [--tones HZ,HZ...] [--amplitude A]\n"
+            "                        [--seed N]\n"
+            "                        [--analyze] [--render IMAGE]\n"
+            "                        [--size WxH] [--render-dir DIR FILE...]\n"
+            "                        [--threads N] [--psd CSV] [--psd-plot IMAGE]\n"
+            "                        [--psd-segment N]\n"
+            "                        [--oversample N] [--bit-rate HZ] [--live RATE]\n"
+            "  --scheme S    nrzl, nrzi, manchester, diff-manchester, ami or mlt3\n"
+            "                (default nrzl)\n"
+            "  --scramble S  b8zs or hdb3, AMI only\n"
+            "  --mod M       pcm, mulaw, alaw (G.711 companded PCM), dm or cvsd (adaptive\n"
+            "                dm): the input is analog sample values, not bits\n"
+            "  --bits N      bits per PCM sample (default 8)\n"
+            "  --range MIN:MAX  fixed PCM range (mulaw/alaw: full scale is the larger\n"
+            "                   magnitude); the input is then encoded as it is read\n"
+            "  --calibrate N    PCM range from the first N samples, then streamed\n"
+            "  --step MIN:MAX   CVSD step bounds (default 0.01:1)\n"
+            "  --run N          CVSD: equal bits in a row that grow the step (default 3)\n"
+            "  --growth G       CVSD: step multiplier after such a run, at least 1\n"
+            "                   (default 1.5)\n"
+            "  --decay D        CVSD: step multiplier after any other bit, in (0, 1]\n"
+            "                   (default 0.9)\n"
+            "  --in PATH     input file, '-' for stdin (default)\n"
+            "  --source WAVE   generate the analog input instead of reading it: sine,\n"
+            "                  multitone, chirp, square, gaussian or uniform\n"
+            "  --rate HZ       source sample rate (default 8000)\n"
+            "  --duration S    source length in seconds (default 1)\n"
+            "  --freq HZ       sine/square frequency, chirp start (default 440)\n"
+            "  --freq-end HZ   chirp end (default 3400)\n"
+            "  --tones HZ,...  multitone frequencies, all above 0; required for\n"
+            "                  multitone\n"
+            "  --amplitude A   peak, or standard deviation for gaussian (default 1)\n"
+            "  --seed N        noise seed (default 1)\n"
+            "  --out PATH    output file, '-' for stdout (default)\n"
+            "  --in-format F   ascii ('0'/'1' text, default), raw (bytes, MSB first)\n"
+            "                  or packed (64-bit little-endian words, LSB first)\n"
+            "  --out-format F  text (default), int8 or int32 (native ints)\n"
+            "  --analyze     report the longest palindrome, runs, transition density, ones\n"
+            "                density, running DC and violations on stderr, and the SQNR\n"
+            "                of analog input after decoding\n"
+            "  --render IMAGE  draw the encoded signal to a .png or .ppm file; symbols\n"
+            "                  are then only written when --out is given\n"
+            "  --size WxH      image size for --render, --psd-plot and --render-dir\n"
+            "                  (default 1200x700)\n"
+            "  --render-dir DIR  draw each FILE to DIR/<name>.png, on every core\n"
+            "  --threads N     workers for --render-dir and --psd (default: one per core)\n"
+            "  --psd CSV       Welch power spectral density of the symbols, '-' for\n"
+            "                  stdout, with DC content and bandwidth on stderr; symbols\n"
+            "                  are then only written when --out is given\n"
+            "  --psd-plot IMAGE  draw the spectrum to a .png or .ppm file\n"
+            "  --psd-segment N   FFT length, a power of two (default 1024)\n"
+            "  --oversample N    samples per symbol for the spectrum (default 8)\n"
+            "  --bit-rate HZ     frequency unit (default 1: multiples of the bit rate)\n"
+            "  --live RATE     scroll the symbols across the OpenGL window at RATE\n"
+            "                  symbols/s, with latency and dropped frames shown\n"
+            "Without arguments the interactive menus and the OpenGL window are used.\n";
+}
+
+// --scheme names an unscrambled code and --scramble one of the codes built
+// on it, both by the name the policy gives.
+bool parseScheme(const string& scheme, const string& scramble, LineCode& code) {
+    int found = -1;
+    for (int c = 0; c < lineCodeCount; c++) {
+        LineCode candidate = (LineCode)c;
+        if (baseCode(candidate) == candidate && scheme == codeName(candidate)) found = c;
+    }
+    if (found < 0) return false;
+    code = (LineCode)found;
+    if (scramble.empty()) return true;
+
+    for (int c = 0; c < lineCodeCount; c++) {
+        LineCode candidate = (LineCode)c;
+        if (candidate != code && baseCode(candidate) == code && scramble == codeName(candidate)) {
+            code = candidate;
+            return true;
+        }
+    }
+    return false;
+}
 
-    float yScale = 0.35f;
-
-    // Title
-    glColor3f(0.0, 0.0, 0.0);
-    drawBoldText(-0.95f, 0.92f, signalTitle);
-
-    // Axes
-    glColor3f(0.0, 0.0, 0.0);
-    glLineWidth(2.5f);
-    glBegin(GL_LINES);
-        glVertex2f(-0.9f, 0.0f);
-        glVertex2f(0.9f, 0.0f);
-        glVertex2f(-0.9f, -0.8f);
-        glVertex2f(-0.9f, 0.8f);
-    glEnd();
-
-    // Grid lines
-    glColor3f(0.7, 0.7, 0.7);
-    glLineWidth(1.0f);
-    glBegin(GL_LINES);
-        glVertex2f(-0.9f, 1.0f * yScale);
-        glVertex2f(0.9f, 1.0f * yScale);
-        glVertex2f(-0.9f, -1.0f * yScale);
-        glVertex2f(0.9f, -1.0f * yScale);
-    glEnd();
-
-    // Vertical divisions
-    glColor3f(0.88, 0.88, 0.88);
-    glLineWidth(0.5f);
-    glBegin(GL_LINES);
-        float xStep = 1.8f / signalLength;
-        for (int i = 0; i <= signalLength; i++) {
-            float x = -0.9f + i * xStep;
-            glVertex2f(x, -0.8f);
-            glVertex2f(x, 0.8f);
+// DIR/<input file name without its extension>.png
+string renderPath(const string& dir, const string& input) {
+    size_t slash = input.find_last_of("/\\");
+    string name = slash == string::npos ? input : input.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    if (dot != string::npos && dot > 0) name.erase(dot);
+    return dir + "/" + name + ".png";
+}
+
+// Non-interactive mode: encodes the input named by the flags and writes the
+// symbols, touching GLUT only for --live. Input goes through runPipeline() a block at
+// a time, with the analysis, plot and spectrum as sinks; only PCM and G.711
+// without a fixed range read the input whole, since they need its range
+// before quantising.
+int runCommandLine(int argc, char** argv) {
+    string scheme = "nrzl", scramble, mod, inPath = "-", outPath = "-";
+    string renderImage, renderDir, psdPath, psdPlot;
+    vector<string> renderInputs;
+    SpectrumParams spectrumParams;
+    double bitRate = 1.0, liveRate = 0.0;
+    int bitsPerSample = 8, width = 1200, height = 700, threads = 0;
+    double rangeMin = 0.0, rangeMax = 0.0;
+    long calibrate = 0;
+    bool fixedRange = false;
+    CVSDParams cvsd;
+    SourceParams sourceParams;
+    bool generate = false;
+    bool analyze = false, outGiven = false;
+    BitFormat inFormat = BITS_ASCII;
+    SymbolFormat outFormat = SYMBOLS_TEXT;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool ok = true;
+        if (arg == "--scheme" && hasValue) scheme = argv[++i];
+        else if (arg == "--scramble" && hasValue) scramble = argv[++i];
+        else if (arg == "--mod" && hasValue) mod = argv[++i];
+        else if (arg == "--bits" && hasValue) bitsPerSample = atoi(argv[++i]);
+        else if (arg == "--range" && hasValue) {
+            fixedRange = true;
+            ok = sscanf(argv[++i], "%lf:%lf", &rangeMin, &rangeMax) == 2 && rangeMin < rangeMax;
+        }
+        else if (arg == "--calibrate" && hasValue) ok = (calibrate = atol(argv[++i])) > 0;
+        else if (arg == "--step" && hasValue) {
+            ok = sscanf(argv[++i], "%lf:%lf", &cvsd.minStep, &cvsd.maxStep) == 2 &&
+                 cvsd.minStep > 0.0 && cvsd.minStep <= cvsd.maxStep;
         }
-    glEnd();
-
-    // Y-axis labels
-    glColor3f(0.0, 0.0, 0.0);
-    drawText(-0.99f, 1.0f * yScale - 0.02f, "+1");
-    drawText(-0.97f, -0.03f, "0");
-    drawText(-0.99f, -1.0f * yScale - 0.02f, "-1");
-
-    // X-axis labels and info
-    int labelStep = 1;
-    if (isManchester) {
-        if (signalLength > 40) labelStep = 4;
-        else if (signalLength > 20) labelStep = 2;
-
-        for (int i = 0; i <= signalLength; i += labelStep) {
-            char label[10];
-            sprintf(label, "%.1f", i * 0.5);
-            float x = -0.9f + i * xStep - 0.02f;
-            drawText(x, -0.88f, label);
+        else if (arg == "--run" && hasValue) ok = (cvsd.run = atoi(argv[++i])) > 0;
+        else if (arg == "--growth" && hasValue) ok = (cvsd.growth = atof(argv[++i])) >= 1.0;
+        else if (arg == "--decay" && hasValue) {
+            cvsd.decay = atof(argv[++i]);
+            ok = cvsd.decay > 0.0 && cvsd.decay <= 1.0;
         }
+        else if (arg == "--source" && hasValue) ok = generate = parseWaveform(argv[++i], sourceParams.wave);
+        else if (arg == "--rate" && hasValue) ok = (sourceParams.sampleRate = atof(argv[++i])) > 0.0;
+        else if (arg == "--duration" && hasValue) ok = (sourceParams.duration = atof(argv[++i])) > 0.0;
+        else if (arg == "--freq" && hasValue) sourceParams.frequency = atof(argv[++i]);
+        else if (arg == "--freq-end" && hasValue) sourceParams.endFrequency = atof(argv[++i]);
+        else if (arg == "--amplitude" && hasValue) sourceParams.amplitude = atof(argv[++i]);
+        else if (arg == "--seed" && hasValue) sourceParams.seed = strtoull(argv[++i], NULL, 10);
+        else if (arg == "--tones" && hasValue) {
+            char* end = argv[++i];
+            do sourceParams.tones.push_back(strtod(end + (*end == ','), &end));
+            while (*end == ',');
+            ok = *end == '\0';
+        }
+        else if (arg == "--in" && hasValue) inPath = argv[++i];
+        else if (arg == "--out" && hasValue) {
+            outPath = argv[++i];
+            outGiven = true;
+        }
+        else if (arg == "--in-format" && hasValue) ok = parseBitFormat(argv[++i], inFormat);
+        else if (arg == "--out-format" && hasValue) ok = parseSymbolFormat(argv[++i], outFormat);
+        else if (arg == "--analyze") analyze = true;
+        else if (arg == "--render" && hasValue) renderImage = argv[++i];
+        else if (arg == "--render-dir" && hasValue) renderDir = argv[++i];
+        else if (arg == "--size" && hasValue) ok = sscanf(argv[++i], "%dx%d", &width, &height) == 2;
+        else if (arg == "--threads" && hasValue) threads = atoi(argv[++i]);
+        else if (arg == "--psd" && hasValue) psdPath = argv[++i];
+        else if (arg == "--psd-plot" && hasValue) psdPlot = argv[++i];
+        else if (arg == "--psd-segment" && hasValue) {
+            spectrumParams.segment = strtoull(argv[++i], NULL, 10);
+            ok = spectrumParams.segment >= 16 && (spectrumParams.segment & (spectrumParams.segment - 1)) == 0;
+        }
+        else if (arg == "--oversample" && hasValue) ok = (spectrumParams.samplesPerSymbol = atoi(argv[++i])) > 0;
+        else if (arg == "--bit-rate" && hasValue) ok = (bitRate = atof(argv[++i])) > 0.0;
+        else if (arg == "--live" && hasValue) ok = (liveRate = atof(argv[++i])) > 0.0;
+        else if (!renderDir.empty() && arg.compare(0, 2, "--") != 0) renderInputs.push_back(arg);
+        else ok = false;
+        if (!ok) {
+            printUsage();
+            return arg == "--help" ? 0 : 2;
+        }
+    }
 
-        glColor3f(0.5, 0.0, 0.5);
-        drawText(-0.3f, -0.95f, "Bit Position (mid-transitions at 0.5, 1.5, 2.5...)");
+    LineCode code;
+    if (!parseScheme(scheme, scramble, code) ||
+        (!mod.empty() && mod != "pcm" && mod != "dm" && mod != "mulaw" && mod != "alaw" &&
+         mod != "cvsd") ||
+        bitsPerSample < 1 || bitsPerSample > 31 ||
+        width < 16 || height < 16 || threads < 0 ||
+        (fixedRange && (mod == "dm" || mod == "cvsd" || mod.empty() || calibrate)) ||
+        (calibrate && mod != "pcm") ||
+        (generate && (mod.empty() || !validSource(sourceParams))) ||
+        (!renderDir.empty() && (renderInputs.empty() || !mod.empty())) ||
+        (liveRate > 0.0 && (analyze || outGiven || !renderImage.empty() || !renderDir.empty() ||
+                            !psdPath.empty() || !psdPlot.empty()))) {
+        printUsage();
+        return 2;
+    }
+#ifdef SIGNAL_HEADLESS
+    if (liveRate > 0.0) {
+        cerr << "--live needs the OpenGL build" << endl;
+        return 2;
+    }
+#endif
+
+    if (!renderDir.empty()) {
+        vector<RenderJob> jobs(renderInputs.size());
+        for (size_t j = 0; j < jobs.size(); j++) {
+            jobs[j].input = renderInputs[j];
+            jobs[j].output = renderPath(renderDir, renderInputs[j]);
+            jobs[j].title = codeTitle(code);
+        }
+        size_t written = renderBatch(jobs, inFormat, code, width, height, (unsigned)threads);
+        if (written != jobs.size()) {
+            cerr << jobs.size() - written << " of " << jobs.size() << " images failed" << endl;
+            return 1;
+        }
+        return 0;
+    }
+    bool spectrum = !psdPath.empty() || !psdPlot.empty();
+    bool keepSymbols = !renderImage.empty() || spectrum;
+    bool writeSymbols = !keepSymbols || outGiven;
+
+    BitReader reader;
+    SymbolWriter writer;
+    BitStream bits;
+    vector<double> analog;
+    bool companded = (mod == "mulaw" || mod == "alaw");
+    Companding law = mod == "mulaw" ? COMPAND_MULAW : COMPAND_ALAW;
+    // Everything but PCM and G.711 without a known range is modulated,
+    // line coded and analysed a block at a time; those two read every
+    // sample first and then run their bits through the same stages.
+    bool streamed = fixedRange || calibrate || mod == "cvsd" || mod == "dm";
+
+    ifstream inFile;
+    if (!mod.empty() && inPath != "-" && !generate) {
+        inFile.open(inPath.c_str());
+        if (!inFile) {
+            cerr << "Cannot open " << inPath << endl;
+            return 1;
+        }
+    }
+    TextSamples text(inFile.is_open() ? (istream&)inFile : cin);
+    AnalogSource generator(sourceParams);
+    GeneratedSamples generated(generator);
+    SampleSource& samples = generate ? (SampleSource&)generated : (SampleSource&)text;
+    BitSource* source = NULL;
+    ModulatedBits* modulated = NULL;
+    Modulator* modulator = NULL;
+    SQNRMeter meter;
+    size_t total = 0;
+
+    if (mod.empty()) {
+        if (!reader.open(inPath.c_str(), inFormat)) {
+            cerr << "Cannot open " << inPath << endl;
+            return 1;
+        }
+        total = reader.sizeKnown() ? reader.totalBits() * symbolsPerBit(code) : 0;
+        if (!analyze && !keepSymbols && liveRate == 0.0) {
+            if (!writer.open(outPath.c_str(), outFormat, total)) {
+                cerr << "Cannot create " << outPath << endl;
+                return 1;
+            }
+            encodeFile(reader, writer, code);
+            return writer.close() ? 0 : 1;
+        }
+        source = new ReaderBits(reader);
+    } else if (streamed) {
+        if (mod == "cvsd") modulator = new CVSDModulator(cvsd);
+        else if (mod == "dm") modulator = new CVSDModulator(CVSDModulator::deltaMod());
+        else if (companded) modulator = new CompandedModulator(law, max(fabs(rangeMin), fabs(rangeMax)));
+        else if (fixedRange) modulator = new PCMModulator(bitsPerSample, rangeMin, rangeMax);
+        else modulator = new PCMModulator(bitsPerSample, (size_t)calibrate);
+        source = modulated = new ModulatedBits(samples, *modulator, analyze ? &meter : NULL);
     } else {
-        if (signalLength > 30) labelStep = 5;
-        else if (signalLength > 15) labelStep = 2;
-
-        for (int i = 0; i <= signalLength; i += labelStep) {
-            char label[10];
-            sprintf(label, "%d", i);
-            float x = -0.9f + i * xStep - 0.015f;
-            drawText(x, -0.88f, label);
+        analog.resize(1 << 16);
+        size_t got = 0;
+        while (size_t n = samples.read(analog.data() + got, analog.size() - got)) {
+            got += n;
+            if (got == analog.size()) analog.resize(2 * got);
         }
+        analog.resize(got);
+        if (analog.empty()) {
+            cerr << "No samples read" << endl;
+            return 1;
+        }
+        if (mod == "pcm") encodePCM(analog.data(), analog.size(), bits, bitsPerSample);
+        else encodeCompanded(law, analog.data(), analog.size(), bits);
+        source = new MemoryBits(bits);
+    }
 
-        glColor3f(0.0, 0.0, 0.0);
-        drawText(-0.08f, -0.95f, "Bit Position");
+#ifndef SIGNAL_HEADLESS
+    if (liveRate > 0.0) {
+        int status = runLive(*source, code, liveRate, argc, argv);
+        delete source;
+        delete modulator;
+        return status;
     }
+#endif
+
+    SymbolStream symbols;
+    SignalStats stats;
+    StatsSink statsSink(code, stats);
+    PalindromeSink palindrome;
+    PackSink pack(code, symbols);
+    vector<Sink*> sinks;
+    if (analyze) {
+        sinks.push_back(&statsSink);
+        sinks.push_back(&palindrome);
+    }
+    if (keepSymbols) sinks.push_back(&pack);
 
-    // Voltage label
-    glColor3f(0.0, 0.0, 0.0);
-    drawText(-0.99f, 0.85f, "Voltage");
+    bool ok = true;
+    if (writeSymbols && !writer.open(outPath.c_str(), outFormat, total)) {
+        cerr << "Cannot create " << outPath << endl;
+        ok = false;
+    }
+    if (ok) runPipeline(*source, code, writeSymbols ? &writer : NULL, sinks);
+    if (ok && writeSymbols) ok = writer.close();
+    bool noSamples = modulated && modulated->samples() == 0;
+    delete source;
+    if (!ok) {
+        delete modulator;
+        return 1;
+    }
+    if (noSamples) {
+        delete modulator;
+        cerr << "No samples read" << endl;
+        return 1;
+    }
 
-    // Draw signal line
-    glColor3f(0.0, 0.0, 1.0);
-    glLineWidth(3.0f);
-    glBegin(GL_LINE_STRIP);
-        for (int i = 0; i < signalLength; i++) {
-            float x1 = -0.9f + i * xStep;
-            float x2 = -0.9f + (i + 1) * xStep;
-            float y = currentSignal[i] * yScale;
-
-            glVertex2f(x1, y);
-            glVertex2f(x2, y);
-
-            if (i < signalLength - 1) {
-                float nextY = currentSignal[i + 1] * yScale;
-                glVertex2f(x2, y);
-                glVertex2f(x2, nextY);
-            }
+    if (!renderImage.empty()) {
+        SymbolPyramid pyramid;
+        pyramid.build(symbols);
+        PlotView view = { &symbols, &pyramid, codeTitle(code), symbolsPerBit(code) == 2,
+                          0.0, (double)max((size_t)1, symbols.size()), (int)(width * 0.9f) };
+        Image image;
+        renderPlot(view, width, height, image);
+        if (!writeImage(image, renderImage)) {
+            cerr << "Cannot create " << renderImage << endl;
+            ok = false;
         }
-    glEnd();
-
-    
-    glColor3f(0.6, 0.0, 0.0);
-    if (signalLength <= 25) {
-        for (int i = 0; i < signalLength; i++) {
-            float x = -0.9f + (i + 0.5f) * xStep - 0.015f;
-            float y = currentSignal[i] * yScale;
-            char valLabel[5];
-
-            if (currentSignal[i] == 1) {
-                sprintf(valLabel, "+1");
-                drawText(x, y + 0.08f, valLabel);
-            } else if (currentSignal[i] == -1) {
-                sprintf(valLabel, "-1");
-                drawText(x, y - 0.12f, valLabel);
-            } else {
-                sprintf(valLabel, "0");
-                drawText(x, y + 0.05f, valLabel);
+    }
+
+    if (spectrum) {
+        spectrumParams.symbolRate = bitRate * symbolsPerBit(code);
+        spectrumParams.threads = (unsigned)threads;
+        Spectrum psd;
+        const char* unit = bitRate == 1.0 ? "x bit rate" : "Hz";
+        if (!welchPSD(symbols, spectrumParams, psd)) {
+            cerr << "Too few symbols for a spectrum" << endl;
+            ok = false;
+        } else {
+            if (!psdPath.empty() && !writeSpectrumCSV(psd, psdPath)) {
+                cerr << "Cannot create " << psdPath << endl;
+                ok = false;
+            }
+            if (!psdPlot.empty()) {
+                string title = string("Power Spectral Density - ") + codeTitle(code);
+                Image image;
+                renderSpectrum(psd, title.c_str(), unit, width, height, image);
+                if (!writeImage(image, psdPlot)) {
+                    cerr << "Cannot create " << psdPlot << endl;
+                    ok = false;
+                }
             }
+            cerr << "\nSpectrum: " << psd.segments << " segments of " << 2 * (psd.density.size() - 1)
+                 << " samples, " << spectrumParams.samplesPerSymbol << " per symbol" << endl;
+            printBandwidth(cerr, measureBandwidth(psd, spectrumParams.symbolRate), unit);
         }
     }
 
-    glFlush();
-}
-
+    if (analyze && modulator) {
+        fprintf(stderr, "SQNR: %.2f dB at %g bits/sample\n", meter.value(),
+                (double)modulator->bitsPerSample());
+    } else if (analyze && !mod.empty()) {
+        // Decode the bits again and compare against what was read.
+        size_t n = analog.size();
+        vector<double> restored(n);
+        double fullScale = 0.0;
+        if (mod == "pcm") {
+            double lo = *min_element(analog.begin(), analog.end());
+            double hi = *max_element(analog.begin(), analog.end());
+            decodePCM(bits, bitsPerSample, lo, hi, restored.data());
+        } else {
+            for (size_t i = 0; i < n; i++) fullScale = max(fullScale, fabs(analog[i]));
+            decodeCompanded(law, bits, restored.data(), fullScale);
+        }
+        fprintf(stderr, "SQNR: %.2f dB at %g bits/sample\n",
+                measureSQNR(analog.data(), restored.data(), n), mod == "pcm" ? (double)bitsPerSample : 8.0);
+    }
+    delete modulator;
 
-void initializeGL() {
-    glClearColor(1.0, 1.0, 1.0, 1.0);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluOrtho2D(-1.0, 1.0, -1.0, 1.0);
+    if (analyze) {
+        // The bits are only all in memory when they were modulated whole.
+        if (mod.empty() || streamed) printPalindrome(cerr, palindrome.longest());
+        else printPalindrome(cerr, bits, palindrome.longest());
+        printStats(cerr, stats);
+    }
+    return ok ? 0 : 1;
 }
 
-
-void showSignal(int* signal, int len, const char* title, bool manchester) {
-    currentSignal = signal;
-    signalLength = len;
-    strcpy(signalTitle, title);
-    isManchester = manchester;
-    glutPostRedisplay();
-}
 //MAIN:-
 
 int main(int argc, char** argv) {
+    if (argc > 1) return runCommandLine(argc, argv);
+
     int modeChoice;
     cout << "----: Digital Signal Generator :----" << endl;
     cout << "1. Digital Input\n2. Analog Input (PCM/DM)\nChoice: ";
     cin >> modeChoice;
 
-    char bitStream[1000];
-    int bitLen = 0;
+    BitStream bitStream;
+    size_t bitLen = 0;
 
     if (modeChoice == 2) {
-        cout << "\n1. PCM\n2. DM\nChoice: ";
+        cout << "\n1. PCM\n2. DM\n3. PCM (mu-law)\n4. PCM (A-law)\n5. CVSD (adaptive DM)\nChoice: ";
         int modType;
         cin >> modType;
 
         int nSamples;
-        cout << "Samples: ";
+        cout << "Samples (0 to generate them): ";
         cin >> nSamples;
 
-        double* analog = new double[nSamples];
-        cout << "Values: ";
-        for (int i = 0; i < nSamples; i++) cin >> analog[i];
+        double* analog;
+        if (nSamples > 0) {
+            analog = new double[nSamples];
+            cout << "Values: ";
+            for (int i = 0; i < nSamples; i++) cin >> analog[i];
+        } else {
+            SourceParams params;
+            int wave;
+            cout << "\n1. Sine\n2. Multi-tone\n3. Chirp\n4. Square\n5. Gaussian noise\n6. Uniform noise\nChoice: ";
+            cin >> wave;
+            params.wave = (Waveform)max(0, min(wave - 1, (int)WAVE_UNIFORM));
+            cout << "Sample rate (Hz): ";
+            cin >> params.sampleRate;
+            cout << "Duration (s): ";
+            cin >> params.duration;
+            if (params.wave == WAVE_MULTITONE) {
+                int tones;
+                cout << "Tones: ";
+                cin >> tones;
+                cout << "Frequencies (Hz): ";
+                params.tones.resize(max(tones, 0));
+                for (int i = 0; i < tones; i++) cin >> params.tones[i];
+            } else if (params.wave != WAVE_GAUSSIAN && params.wave != WAVE_UNIFORM) {
+                cout << (params.wave == WAVE_CHIRP ? "Start frequency (Hz): " : "Frequency (Hz): ");
+                cin >> params.frequency;
+                if (params.wave == WAVE_CHIRP) {
+                    cout << "End frequency (Hz): ";
+                    cin >> params.endFrequency;
+                }
+            }
+            AnalogSource source(params);
+            // The whole run is held in memory and counted in ints here.
+            if (!validSource(params) || source.total() > (size_t)INT_MAX) {
+                cout << "Invalid!" << endl;
+                return 1;
+            }
+            nSamples = (int)source.total();
+            analog = new double[max(nSamples, 1)];
+            source.next(analog, nSamples);
+        }
 
         if (modType == 1) {
             int bits;
             cout << "Bits/sample: ";
             cin >> bits;
             bitLen = encodePCM(analog, nSamples, bitStream, bits);
-            cout << "\nPCM: " << bitStream << endl;
+            cout << "\nPCM: ";
+            printBits(bitStream);
+            cout << endl;
+        } else if (modType == 3 || modType == 4) {
+            Companding law = modType == 3 ? COMPAND_MULAW : COMPAND_ALAW;
+            bitLen = encodeCompanded(law, analog, nSamples, bitStream);
+            cout << (modType == 3 ? "\nmu-law: " : "\nA-law: ");
+            printBits(bitStream);
+            cout << endl;
+
+            double peak = 0.0;
+            for (int i = 0; i < nSamples; i++) peak = max(peak, fabs(analog[i]));
+            double* decodedAnalog = new double[nSamples];
+            decodeCompanded(law, bitStream, decodedAnalog, peak);
+            cout << "Decoded:";
+            for (int i = 0; i < nSamples; i++) cout << " " << decodedAnalog[i];
+            cout << endl;
+            delete[] decodedAnalog;
         } else {
-            bitLen = encodeDeltaMod(analog, nSamples, bitStream);
-            cout << "\nDM: " << bitStream << endl;
+            double* decodedAnalog = new double[nSamples];
+            if (modType == 5) {
+                CVSDEncoder encoder;
+                encoder.push(analog, nSamples, bitStream);
+                CVSDDecoder().push(bitStream, decodedAnalog);
+                cout << "\nCVSD: ";
+            } else {
+                encodeDeltaMod(analog, nSamples, bitStream);
+                decodeDeltaMod(bitStream, decodedAnalog);
+                cout << "\nDM: ";
+            }
+            bitLen = bitStream.size();
+            printBits(bitStream);
+            cout << "\nSQNR: " << measureSQNR(analog, decodedAnalog, nSamples) << " dB" << endl;
+            delete[] decodedAnalog;
         }
         delete[] analog;
     } else {
         cout << "Binary data: ";
-        cin >> bitStream;
-        bitLen = strlen(bitStream);
+        string input;
+        cin >> input;
+        bitLen = parseBits(input, bitStream);
     }
 
-    findLongestPalindrome(bitStream, bitLen);
+    printPalindrome(cout, bitStream, findLongestPalindrome(bitStream));
 
-    cout << "\n1. NRZ-L\n2. NRZ-I\n3. Manchester\n4. Diff Manchester\n5. AMI\nChoice: ";
-    int encChoice;
+    // Unscrambled codes first, then the scramblers for the chosen one.
+    vector<LineCode> choices;
+    cout << "\n";
+    for (int c = 0; c < lineCodeCount; c++) {
+        if (baseCode((LineCode)c) != (LineCode)c) continue;
+        choices.push_back((LineCode)c);
+        cout << choices.size() << ". " << codeTitle((LineCode)c) << "\n";
+    }
+    cout << "Choice: ";
+    size_t encChoice = 0;
     cin >> encChoice;
+    if (encChoice < 1 || encChoice > choices.size()) {
+        cout << "Invalid!" << endl;
+        return 1;
+    }
+    LineCode code = choices[encChoice - 1];
 
-    int* encoded = NULL;
-    int encLen = 0;
-    char title[100];
-    bool manchesterFlag = false;
-
-    switch (encChoice) {
-        case 1:
-            encLen = bitLen;
-            encoded = new int[encLen];
-            encodeNRZL(bitStream, encoded, bitLen);
-            strcpy(title, "NRZ-L Encoding");
-            break;
-
-        case 2:
-            encLen = bitLen;
-            encoded = new int[encLen];
-            encodeNRZI(bitStream, encoded, bitLen);
-            strcpy(title, "NRZ-I Encoding");
-            break;
-
-        case 3:
-            encLen = bitLen * 2;
-            encoded = new int[encLen];
-            encodeManchester(bitStream, encoded, bitLen);
-            strcpy(title, "Manchester Encoding");
-            manchesterFlag = true;
-            break;
-
-        case 4:
-            encLen = bitLen * 2;
-            encoded = new int[encLen];
-            encodeDiffManchester(bitStream, encoded, bitLen);
-            strcpy(title, "Differential Manchester");
-            manchesterFlag = true;
-            break;
-
-        case 5:
-            encLen = bitLen;
-            encoded = new int[encLen];
-            encodeAMI(bitStream, encoded, bitLen);
-            strcpy(title, "AMI Encoding");
-
-            cout << "\nScrambling? (1=Yes, 0=No): ";
-            int scrambleChoice;
-            cin >> scrambleChoice;
-
-            if (scrambleChoice == 1) {
-                cout << "1. B8ZS\n2. HDB3\nChoice: ";
-                int scrType;
-                cin >> scrType;
-
-                if (scrType == 1) {
-                    // B8ZS
-                    scrambleB8ZS(bitStream, encoded, encLen);
-                    strcpy(title, "AMI with B8ZS");
-                    
-                } else {
-                    scrambleHDB3(bitStream, encoded, encLen);
-                    strcpy(title, "AMI with HDB3");
-                }
-
-                findLongestZeroRun(encoded, encLen);
+    vector<LineCode> scramblers;
+    for (int c = 0; c < lineCodeCount; c++) {
+        if ((LineCode)c != code && baseCode((LineCode)c) == code) scramblers.push_back((LineCode)c);
+    }
+    if (!scramblers.empty()) {
+        cout << "\nScrambling? (1=Yes, 0=No): ";
+        int scrambleChoice;
+        cin >> scrambleChoice;
+
+        if (scrambleChoice == 1) {
+            for (size_t i = 0; i < scramblers.size(); i++) {
+                cout << i + 1 << ". " << codeTitle(scramblers[i]) << "\n";
             }
-            break;
-
-        default:
-            cout << "Invalid!" << endl;
-            return 1;
+            cout << "Choice: ";
+            size_t scrType = 0;
+            cin >> scrType;
+            code = scramblers[scrType >= 1 && scrType <= scramblers.size() ? scrType - 1 : scramblers.size() - 1];
+        }
     }
 
+    SymbolStream encoded;
+    SignalStats stats;
+    encodeSymbols(code, bitStream, encoded, &stats);
+    const char* title = codeTitle(code);
+    bool manchesterFlag = symbolsPerBit(code) == 2;
+
     cout << "\nSignal: ";
-    for (int i = 0; i < encLen; i++) cout << encoded[i] << " ";
+    for (size_t i = 0; i < encoded.size(); i++) cout << encoded.get(i) << " ";
     cout << endl;
 
+    BitStream decoded;
+    size_t violations = decodeSignal(code, encoded, decoded);
+    bool match = decoded.size() == bitLen && decoded.words == bitStream.words;
+    cout << "Loopback decode: " << (match ? "OK" : "MISMATCH")
+         << " (" << violations << " code violations)" << endl;
+    printStats(cout, stats);
+
+#ifdef SIGNAL_HEADLESS
+    (void)argv;
+    (void)title;
+    (void)manchesterFlag;
+#else
     glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
     glutInitWindowSize(1200, 700);
     glutInitWindowPosition(50, 50);
     glutCreateWindow("Digital Signal Visualization");
 
     initializeGL();
-    showSignal(encoded, encLen, title, manchesterFlag);
+    showSignal(encoded, title, manchesterFlag);
     glutDisplayFunc(display);
+    glutReshapeFunc(reshape);
+    glutMouseFunc(mouse);
+    glutMotionFunc(motion);
+    glutKeyboardFunc(keyboard);
 
-    cout << "\nOpenGL window opened. Close to exit..." << endl;
+    cout << "\nOpenGL window opened (wheel: zoom, drag: pan, 0: reset). Close to exit..." << endl;
     glutMainLoop();
+#endif
 
-    delete[] encoded;
     return 0;
 }
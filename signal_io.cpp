@@ -0,0 +1,400 @@
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include "signal_io.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+bool parseBitFormat(const char* name, BitFormat& format) {
+    if (strcmp(name, "ascii") == 0) format = BITS_ASCII;
+    else if (strcmp(name, "raw") == 0) format = BITS_RAW;
+    else if (strcmp(name, "packed") == 0) format = BITS_PACKED;
+    else return false;
+    return true;
+}
+
+bool parseSymbolFormat(const char* name, SymbolFormat& format) {
+    if (strcmp(name, "text") == 0) format = SYMBOLS_TEXT;
+    else if (strcmp(name, "int8") == 0) format = SYMBOLS_INT8;
+    else if (strcmp(name, "int32") == 0) format = SYMBOLS_INT32;
+    else return false;
+    return true;
+}
+
+//MAPPING:-
+
+// Empty files open fine but map nothing: data() stays NULL. Only regular
+// files are mapped; pipes, FIFOs and devices fail to open here and are read
+// as streams instead.
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : base(NULL), length(0), file(INVALID_HANDLE_VALUE), mapping(NULL) {}
+
+bool MappedFile::open(const char* path) {
+    close();
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size)) {
+        close();
+        return false;
+    }
+    length = (size_t)size.QuadPart;
+    if (length == 0) return true;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) base = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!base) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::create(const char* path, size_t size) {
+    close();
+    file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    length = size;
+    if (length == 0) return true;
+    // Mapping more than the file holds extends it to that size.
+    mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                                 (DWORD)((unsigned long long)size >> 32), (DWORD)size, NULL);
+    if (mapping) base = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+    if (!base) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (base) UnmapViewOfFile(base);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    base = NULL;
+    length = 0;
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile() : base(NULL), length(0), fd(-1) {}
+
+bool MappedFile::open(const char* path) {
+    close();
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close();
+        return false;
+    }
+    length = (size_t)st.st_size;
+    if (length == 0) return true;
+    void* p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        close();
+        return false;
+    }
+    base = (unsigned char*)p;
+    madvise(p, length, MADV_SEQUENTIAL);
+    return true;
+}
+
+bool MappedFile::create(const char* path, size_t size) {
+    close();
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    length = size;
+    if (length == 0) return true;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close();
+        return false;
+    }
+    void* p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close();
+        return false;
+    }
+    base = (unsigned char*)p;
+    return true;
+}
+
+void MappedFile::close() {
+    if (base) munmap(base, length);
+    if (fd >= 0) ::close(fd);
+    base = NULL;
+    length = 0;
+    fd = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+//READING:-
+
+// Reverses the bits of each byte, turning eight MSB-first bytes loaded as a
+// little-endian word into the packed LSB-first layout.
+static inline uint64_t reverseByteBits(uint64_t x) {
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return x;
+}
+
+BitReader::BitReader() : stream(NULL), format(BITS_ASCII), offset(0) {}
+
+BitReader::~BitReader() {
+    if (stream && stream != stdin) fclose(stream);
+}
+
+bool BitReader::open(const char* path, BitFormat fmt) {
+    if (stream && stream != stdin) fclose(stream);
+    format = fmt;
+    offset = 0;
+    stream = NULL;
+    if (strcmp(path, "-") == 0) {
+        stream = stdin;
+#ifdef _WIN32
+        if (format != BITS_ASCII) _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        return true;
+    }
+    if (map.open(path)) return true;
+    // Not a mappable file (a pipe, FIFO or device): read it like stdin.
+    stream = fopen(path, "rb");
+    return stream != NULL;
+}
+
+bool BitReader::sizeKnown() const {
+    return !stream && format != BITS_ASCII;
+}
+
+size_t BitReader::totalBits() const {
+    return sizeKnown() ? map.size() * 8 : 0;
+}
+
+bool BitReader::whole(BitView& bits) const {
+    if (stream || format != BITS_PACKED) return false;
+    bits = BitView((const uint64_t*)map.data(), map.size() * 8);
+    return true;
+}
+
+// Up to max input bytes: a pointer into the mapping, or into `raw` after a
+// read from the stream.
+const unsigned char* BitReader::take(size_t max, size_t& got) {
+    if (!stream) {
+        got = min(max, map.size() - offset);
+        const unsigned char* p = map.data() + offset;
+        offset += got;
+        return p;
+    }
+    raw.resize(max);
+    got = fread(raw.data(), 1, max, stream);
+    return raw.data();
+}
+
+bool BitReader::next(BitView& out) {
+    size_t got;
+
+    if (format == BITS_PACKED && !stream) {
+        // Chunks are whole words, so every view stays word-aligned. Bytes
+        // past the end of the file in its last page read as zero.
+        const unsigned char* p = take(chunkBits / 8, got);
+        if (got == 0) return false;
+        out = BitView((const uint64_t*)p, got * 8);
+        return true;
+    }
+
+    if (format == BITS_PACKED || format == BITS_RAW) {
+        const unsigned char* p = take(chunkBits / 8, got);
+        if (got == 0) return false;
+        chunk.clear();
+        chunk.resize(got * 8);
+        memcpy(chunk.words.data(), p, got);
+        if (format == BITS_RAW) {
+            for (size_t w = 0; w < chunk.words.size(); w++) {
+                chunk.words[w] = reverseByteBits(chunk.words[w]);
+            }
+        }
+        out = chunk;
+        return true;
+    }
+
+    // ASCII: one bit per non-space character, '1' for 1 and anything else
+    // for 0, the same as parseBits().
+    chunk.clear();
+    chunk.resize(chunkBits);
+    size_t n = 0;
+    while (n < chunkBits) {
+        const unsigned char* p = take(chunkBits - n, got);
+        if (got == 0) break;
+        for (size_t i = 0; i < got; i++) {
+            if (isspace(p[i])) continue;
+            if (p[i] == '1') chunk.words[n >> 6] |= 1ULL << (n & 63);
+            n++;
+        }
+    }
+    if (n == 0) return false;
+    chunk.resize(n);
+    out = chunk;
+    return true;
+}
+
+//WRITING:-
+
+static const size_t writeBufferBytes = (size_t)1 << 20;
+
+SymbolWriter::SymbolWriter() : stream(NULL), format(SYMBOLS_TEXT), written(0), used(0) {}
+
+SymbolWriter::~SymbolWriter() {
+    close();
+}
+
+bool SymbolWriter::open(const char* path, SymbolFormat fmt, size_t total) {
+    format = fmt;
+    written = 0;
+    used = 0;
+    stream = NULL;
+    bool toStdout = strcmp(path, "-") == 0;
+
+    if (!toStdout && format != SYMBOLS_TEXT && total > 0) {
+        size_t width = format == SYMBOLS_INT32 ? sizeof(int) : 1;
+        if (map.create(path, total * width)) return true;
+    }
+
+    if (toStdout) {
+        stream = stdout;
+#ifdef _WIN32
+        if (format != SYMBOLS_TEXT) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    } else {
+        stream = fopen(path, "wb");
+        if (!stream) return false;
+    }
+    buffer.resize(writeBufferBytes);
+    return true;
+}
+
+int* SymbolWriter::reserve(size_t n) {
+    if (mapped()) return (int*)map.data() + written;
+    if (scratch.size() < n) scratch.resize(n);
+    return scratch.data();
+}
+
+void SymbolWriter::commit(size_t n) {
+    if (mapped()) written += n;
+    else write(scratch.data(), n);
+}
+
+void SymbolWriter::flush() {
+    if (used) fwrite(buffer.data(), 1, used, stream);
+    used = 0;
+}
+
+void SymbolWriter::write(const int* symbols, size_t n) {
+    if (map.data()) {
+        if (format == SYMBOLS_INT32) {
+            memcpy((int*)map.data() + written, symbols, n * sizeof(int));
+        } else {
+            signed char* dst = (signed char*)map.data() + written;
+            for (size_t i = 0; i < n; i++) dst[i] = (signed char)symbols[i];
+        }
+        written += n;
+        return;
+    }
+    if (!stream) return;
+
+    if (format == SYMBOLS_INT32) {
+        flush();
+        fwrite(symbols, sizeof(int), n, stream);
+        written += n;
+        return;
+    }
+
+    // A symbol takes at most 12 bytes of text ("-2147483648 ").
+    size_t room = format == SYMBOLS_TEXT ? 12 : 1;
+    for (size_t i = 0; i < n; i++) {
+        if (used + room > buffer.size()) flush();
+        char* dst = buffer.data() + used;
+        int s = symbols[i];
+        if (format == SYMBOLS_INT8) {
+            *dst = (char)(signed char)s;
+            used++;
+        } else if (s == 1) {
+            memcpy(dst, "1 ", 2);
+            used += 2;
+        } else if (s == 0) {
+            memcpy(dst, "0 ", 2);
+            used += 2;
+        } else if (s == -1) {
+            memcpy(dst, "-1 ", 3);
+            used += 3;
+        } else {
+            used += snprintf(dst, room, "%d ", s);
+        }
+    }
+    written += n;
+}
+
+bool SymbolWriter::close() {
+    bool ok = true;
+    if (stream) {
+        if (format == SYMBOLS_TEXT) {
+            if (used + 1 > buffer.size()) flush();
+            buffer[used++] = '\n';
+        }
+        flush();
+        ok = fflush(stream) == 0 && !ferror(stream);
+        if (stream != stdout) ok = fclose(stream) == 0 && ok;
+        stream = NULL;
+    }
+    map.close();
+    return ok;
+}
+
+//ENCODING:-
+
+size_t encodeFile(BitReader& in, SymbolWriter& out, LineCode code) {
+    // A mapped packed input into a mapped int32 output is encoded in place,
+    // across every core, with no copy in either direction.
+    BitView bits(NULL, 0);
+    if (out.mapped() && in.whole(bits)) {
+        size_t total = bits.size() * symbolsPerBit(code);
+        encodeParallel(code, bits, out.reserve(total));
+        out.commit(total);
+        return total;
+    }
+
+    StreamEncoder* encoder = makeEncoder(code);
+    size_t total = 0, k;
+    BitView chunk(NULL, 0);
+    while (in.next(chunk)) {
+        k = encoder->push(chunk, out.reserve(encoder->maxOutput(chunk.size())));
+        out.commit(k);
+        total += k;
+    }
+    k = encoder->finish(out.reserve(encoder->maxOutput(0)));
+    out.commit(k);
+    delete encoder;
+    return total + k;
+}
@@ -0,0 +1,133 @@
+#ifndef SIGNAL_IO_H
+#define SIGNAL_IO_H
+
+// File input and output for bit streams and symbol streams. Files are
+// memory-mapped (POSIX mmap or Win32 file mappings) so encoders read and
+// write the mapped pages directly; stdin/stdout fall back to large buffered
+// reads and writes.
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include <stdint.h>
+#include "signal_core.h"
+
+// Bit input formats:
+//   BITS_ASCII   '0'/'1' characters, whitespace ignored
+//   BITS_RAW     bytes, most significant bit first
+//   BITS_PACKED  64-bit little-endian words, bit i at position i % 64 of
+//                word i / 64 (the in-memory BitStream layout)
+enum BitFormat { BITS_ASCII, BITS_RAW, BITS_PACKED };
+
+// Symbol output formats:
+//   SYMBOLS_TEXT   space-separated "-1", "0", "1"
+//   SYMBOLS_INT8   one signed byte per symbol
+//   SYMBOLS_INT32  one native int per symbol, the encoders' own layout
+enum SymbolFormat { SYMBOLS_TEXT, SYMBOLS_INT8, SYMBOLS_INT32 };
+
+bool parseBitFormat(const char* name, BitFormat& format);
+bool parseSymbolFormat(const char* name, SymbolFormat& format);
+
+// A whole regular file mapped into memory, read-only or (with create)
+// read-write.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char* path);
+    bool create(const char* path, size_t size);
+    void close();
+
+    unsigned char* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    unsigned char* base;
+    size_t length;
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#else
+    int fd;
+#endif
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+// Hands out the input as chunks of packed bits. Packed files are served as
+// views straight onto the mapping; raw and ASCII input is converted one
+// chunk at a time, so memory use does not grow with the input.
+class BitReader {
+public:
+    BitReader();
+    ~BitReader();
+
+    // path "-" reads stdin; pipes, FIFOs and devices are read the same way.
+    bool open(const char* path, BitFormat format);
+
+    // Next chunk of at most chunkBits bits; false at the end of the input.
+    bool next(BitView& chunk);
+
+    // Total bit count when known before reading (mapped raw/packed files).
+    bool sizeKnown() const;
+    size_t totalBits() const;
+
+    // The whole input without copying; mapped packed files only.
+    bool whole(BitView& bits) const;
+
+    static const size_t chunkBits = (size_t)1 << 20;
+
+private:
+    MappedFile map;
+    FILE* stream;
+    BitFormat format;
+    size_t offset;          // bytes of the mapping consumed so far
+    std::vector<unsigned char> raw;
+    BitStream chunk;
+
+    const unsigned char* take(size_t max, size_t& got);
+    BitReader(const BitReader&);
+    BitReader& operator=(const BitReader&);
+};
+
+// Writes symbols through a large buffer, or into a mapped output file when
+// the total is known up front. SYMBOLS_INT32 is then written in place by the
+// encoders; SYMBOLS_INT8 is narrowed into the mapping a chunk at a time.
+class SymbolWriter {
+public:
+    SymbolWriter();
+    ~SymbolWriter();
+
+    // path "-" writes stdout. total is the symbol count if known, else 0.
+    bool open(const char* path, SymbolFormat format, size_t total = 0);
+
+    // Memory the encoder may write up to n int symbols into; commit() then
+    // accounts for however many it actually wrote.
+    int* reserve(size_t n);
+    void commit(size_t n);
+
+    void write(const int* symbols, size_t n);
+    bool close();
+
+    // True when reserve() hands out the output file itself.
+    bool mapped() const { return format == SYMBOLS_INT32 && map.data() != NULL; }
+
+private:
+    MappedFile map;
+    FILE* stream;
+    SymbolFormat format;
+    size_t written;
+    std::vector<int> scratch;
+    std::vector<char> buffer;
+    size_t used;
+
+    void flush();
+    SymbolWriter(const SymbolWriter&);
+    SymbolWriter& operator=(const SymbolWriter&);
+};
+
+// Encodes everything from `in` into `out`. Returns the symbol count.
+size_t encodeFile(BitReader& in, SymbolWriter& out, LineCode code);
+
+#endif
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstring>
+#include "signal_live.h"
+using namespace std;
+
+//ENCODER:-
+
+LiveEncoder::LiveEncoder(BitSource& s, LineCode c, double rate, LiveRing& r)
+    : source(s), code(c), symbolRate(rate), ring(r),
+      frameSymbols(liveFrameSymbols(rate)),
+      stopping(false), done(false), frames(0), drops(0), startTime(0) {
+    pending.first = 0;
+    pending.count = 0;
+}
+
+LiveEncoder::~LiveEncoder() {
+    stop();
+}
+
+void LiveEncoder::start() {
+    startTime = liveClock();
+    worker = thread(&LiveEncoder::run, this);
+}
+
+void LiveEncoder::stop() {
+    stopping.store(true);
+    if (worker.joinable()) worker.join();
+}
+
+void LiveEncoder::run() {
+    const size_t blockBits = 1024;
+    StreamEncoder* encoder = makeEncoder(code);
+    vector<int> staging(encoder->maxOutput(blockBits));
+    BitView chunk(NULL, 0);
+    while (!stopping.load(memory_order_relaxed) && source.next(chunk)) {
+        for (size_t base = 0; base < chunk.size(); base += blockBits) {
+            BitView block = chunk.slice(base / 64, min(blockBits, chunk.size() - base));
+            emit(staging.data(), encoder->push(block, staging.data()));
+            if (stopping.load(memory_order_relaxed)) break;
+        }
+    }
+    if (!stopping.load(memory_order_relaxed)) {
+        emit(staging.data(), encoder->finish(staging.data()));
+        if (pending.count) release();
+    }
+    delete encoder;
+    done.store(true, memory_order_release);
+}
+
+void LiveEncoder::emit(const int* symbols, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        pending.symbols[pending.count++] = (int8_t)symbols[i];
+        if (pending.count == frameSymbols) release();
+    }
+}
+
+// Waits for the symbol clock to pass the end of the frame, then offers it.
+// The wait is sliced so stop() is not held up at slow rates.
+void LiveEncoder::release() {
+    uint64_t end = pending.first + pending.count;
+    int64_t due = startTime + (int64_t)(end * 1e9 / symbolRate);
+    for (int64_t now = liveClock(); now < due && !stopping.load(memory_order_relaxed); now = liveClock()) {
+        this_thread::sleep_for(chrono::nanoseconds(min(due - now, (int64_t)20000000)));
+    }
+    LiveFrame* slot = ring.claim();
+    if (slot) {
+        slot->first = pending.first;
+        slot->due = due;
+        slot->count = pending.count;
+        memcpy(slot->symbols, pending.symbols, pending.count);
+        ring.publish();
+        frames.fetch_add(1, memory_order_relaxed);
+    } else {
+        drops.fetch_add(1, memory_order_relaxed);
+    }
+    pending.first = end;
+    pending.count = 0;
+}
+
+//DISPLAY:-
+
+LiveHistory::LiveHistory(size_t capacity)
+    : history(max(capacity, (size_t)1)), received(0), end(0), newestDue(0), fresh(false),
+      last(0.0), total(0.0), worst(0.0), samples(0) {}
+
+size_t LiveHistory::drain(LiveRing& ring) {
+    size_t got = 0, n = history.size();
+    for (const LiveFrame* f = ring.front(); f; f = ring.front()) {
+        size_t at = (size_t)(received % n);
+        for (int i = 0; i < f->count; i++) {
+            history[at] = f->symbols[i];
+            if (++at == n) at = 0;
+        }
+        received += f->count;
+        got += f->count;
+        end = f->first + f->count;
+        newestDue = f->due;
+        ring.pop();
+    }
+    if (got) fresh = true;
+    return got;
+}
+
+void LiveHistory::window(size_t n, bool ternary, SymbolStream& out) {
+    n = min(n, size());
+    staging.resize(n);
+    size_t cap = history.size(), at = (size_t)((received - n) % cap);
+    for (size_t i = 0; i < n; i++) {
+        staging[i] = history[at];
+        if (++at == cap) at = 0;
+    }
+    packSymbols(staging.data(), n, ternary, out);
+}
+
+void LiveHistory::shown(int64_t now) {
+    if (!fresh) return;
+    fresh = false;
+    last = (double)(now - newestDue);
+    total += last;
+    samples++;
+    worst = max(worst, last);
+}
@@ -0,0 +1,164 @@
+#ifndef SIGNAL_LIVE_H
+#define SIGNAL_LIVE_H
+
+// Live symbol feed for the oscilloscope view. An encoder thread line codes a
+// BitSource at a set symbol rate and publishes the symbols in small frames
+// through a single-producer, single-consumer ring; the display side takes
+// them out in place. Neither side locks or waits on the other: a frame that
+// finds the ring full is dropped and counted, so a slow display never slows
+// the signal down.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include "signal_core.h"
+#include "signal_pipeline.h"
+
+//RING:-
+
+// Fixed-size ring of slots written in place. The producer fills claim() and
+// then publish()es it; the consumer reads front() and then pop()s it. Each
+// index is written by one side only, with release stores that the other
+// side's acquire loads pair with, and the two sit on separate cache lines.
+template <class T>
+class SPSCRing {
+public:
+    // capacity is rounded up to a power of two.
+    SPSCRing(size_t capacity) : head(0), tail(0) {
+        size_t n = 2;
+        while (n < capacity) n *= 2;
+        slots.resize(n);
+        mask = n - 1;
+    }
+
+    // Producer: the next free slot, or NULL when the ring is full.
+    T* claim() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) return NULL;
+        return &slots[h & mask];
+    }
+    void publish() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer: the oldest published slot, or NULL when there is none.
+    const T* front() const {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return NULL;
+        return &slots[t & mask];
+    }
+    void pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;   // slots published, producer-owned
+    alignas(64) std::atomic<size_t> tail;   // slots consumed, consumer-owned
+
+    SPSCRing(const SPSCRing&);
+    SPSCRing& operator=(const SPSCRing&);
+};
+
+//FRAMES:-
+
+const int liveFrameCapacity = 256;
+
+struct LiveFrame {
+    uint64_t first;         // stream index of symbols[0]
+    int64_t due;            // steady_clock nanoseconds at which it was due on the line
+    int count;
+    int8_t symbols[liveFrameCapacity];
+};
+
+typedef SPSCRing<LiveFrame> LiveRing;
+
+// Symbols per frame at rate: about 1/240 s, so the view can scroll smoothly
+// at any rate.
+inline int liveFrameSymbols(double rate) {
+    return (int)std::max(1.0, std::min((double)liveFrameCapacity, rate / 240));
+}
+
+inline int64_t liveClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//ENCODER:-
+
+// Runs source through the line coder on its own thread, releasing frames
+// of liveFrameSymbols() as the symbol clock reaches them.
+class LiveEncoder {
+public:
+    LiveEncoder(BitSource& source, LineCode code, double symbolRate, LiveRing& ring);
+    ~LiveEncoder();
+
+    void start();
+    void stop();
+
+    double rate() const { return symbolRate; }
+    uint64_t produced() const { return frames.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return drops.load(std::memory_order_relaxed); }
+    // True once the source has run out and every frame has been offered.
+    bool finished() const { return done.load(std::memory_order_acquire); }
+
+private:
+    BitSource& source;
+    LineCode code;
+    double symbolRate;
+    LiveRing& ring;
+    int frameSymbols;
+    std::thread worker;
+    std::atomic<bool> stopping, done;
+    std::atomic<uint64_t> frames, drops;
+    int64_t startTime;
+    LiveFrame pending;
+
+    void run();
+    void emit(const int* symbols, size_t n);
+    void release();
+
+    LiveEncoder(const LiveEncoder&);
+    LiveEncoder& operator=(const LiveEncoder&);
+};
+
+//DISPLAY:-
+
+// The consumer's side: the latest symbols in a circular history, and how
+// late they reached the screen. drain() copies only the frames published
+// since the last call. Symbols of dropped frames are skipped, so the
+// history runs on across the gap.
+class LiveHistory {
+public:
+    LiveHistory(size_t capacity);
+
+    // Takes every frame waiting in ring; returns how many symbols arrived.
+    size_t drain(LiveRing& ring);
+    // The newest n symbols, oldest first, packed for the plot.
+    void window(size_t n, bool ternary, SymbolStream& out);
+
+    size_t size() const { return received < history.size() ? (size_t)received : history.size(); }
+    size_t capacity() const { return history.size(); }
+    uint64_t streamEnd() const { return end; }     // stream index after the newest symbol
+
+    // Time from the newest frame being due to it being on screen; call
+    // after each buffer swap. The mean is over every update since the start.
+    void shown(int64_t now);
+    double lastLatency() const { return last * 1e-6; }     // ms
+    double meanLatency() const { return samples ? total / samples * 1e-6 : 0.0; }
+    double maxLatency() const { return worst * 1e-6; }
+
+private:
+    std::vector<int8_t> history;
+    uint64_t received, end;
+    int64_t newestDue;
+    bool fresh;
+    double last, total, worst;     // ns; total over every update
+    uint64_t samples;
+    std::vector<int> staging;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cmath>
+#include "signal_pipeline.h"
+using namespace std;
+
+//SAMPLES:-
+
+size_t MemorySamples::read(double* out, size_t max) {
+    size_t n = min(max, count);
+    copy(samples, samples + n, out);
+    samples += n;
+    count -= n;
+    return n;
+}
+
+size_t TextSamples::read(double* out, size_t max) {
+    size_t n = 0;
+    while (n < max && in >> out[n]) n++;
+    return n;
+}
+
+//MODULATORS:-
+
+CVSDParams CVSDModulator::deltaMod() {
+    CVSDParams p;
+    p.minStep = p.maxStep = 0.5;
+    return p;
+}
+
+// Samples still waiting for their bits sit at [first, size) of waiting; the
+// vector is compacted once the matched half outgrows the rest.
+void SQNRMeter::original(const double* analog, size_t n) {
+    if (first > waiting.size() / 2) {
+        waiting.erase(waiting.begin(), waiting.begin() + first);
+        first = 0;
+    }
+    waiting.insert(waiting.end(), analog, analog + n);
+}
+
+void SQNRMeter::decoded(const double* analog, size_t n) {
+    n = min(n, waiting.size() - first);
+    const double* x = waiting.data() + first;
+    for (size_t i = 0; i < n; i++) {
+        double e = x[i] - analog[i];
+        signal += x[i] * x[i];
+        noise += e * e;
+    }
+    first += n;
+    samples += n;
+}
+
+double SQNRMeter::value() const {
+    return noise > 0.0 ? 10.0 * log10(signal / noise) : HUGE_VAL;
+}
+
+//SOURCES:-
+
+bool MemoryBits::next(BitView& chunk) {
+    if (done || bits.size() == 0) return false;
+    chunk = bits;
+    done = true;
+    return true;
+}
+
+ModulatedBits::ModulatedBits(SampleSource& s, Modulator& m, SQNRMeter* q)
+    : source(s), modulator(m), meter(q), total(0), ended(false) {
+    analog.resize(max(pipelineBlockBits / modulator.bitsPerSample(), (size_t)1));
+}
+
+bool ModulatedBits::next(BitView& chunk) {
+    // Calibrating PCM holds samples back, so a block can yield no bits.
+    block.clear();
+    while (block.size() == 0 && !ended) {
+        size_t got = source.read(analog.data(), analog.size());
+        total += got;
+        if (meter) meter->original(analog.data(), got);
+        if (got) modulator.push(analog.data(), got, block);
+        else {
+            modulator.finish(block);
+            ended = true;
+        }
+    }
+    if (block.size() == 0) return false;
+    if (meter) {
+        restored.resize(block.size() / modulator.bitsPerSample());
+        meter->decoded(restored.data(), modulator.decode(block, restored.data()));
+    }
+    chunk = block;
+    return true;
+}
+
+//PIPELINE:-
+
+size_t runPipeline(BitSource& source, LineCode code, SymbolWriter* out, const vector<Sink*>& sinks) {
+    StreamEncoder* encoder = makeEncoder(code);
+    vector<int> staging(out ? 0 : encoder->maxOutput(pipelineBlockBits));
+    size_t total = 0, nSinks = sinks.size();
+    BitView chunk(NULL, 0);
+    for (bool more = true; more; ) {
+        more = source.next(chunk);
+        size_t n = more ? chunk.size() : 0;
+        // One pass for the final flush, which takes no bits.
+        for (size_t base = 0; base < n || (!more && base == 0); base += pipelineBlockBits) {
+            BitView block = chunk.slice(base / 64, min(pipelineBlockBits, n - base));
+            for (size_t s = 0; s < nSinks && more; s++) sinks[s]->bits(block);
+            int* symbols = out ? out->reserve(encoder->maxOutput(block.size())) : staging.data();
+            size_t k = more ? encoder->push(block, symbols) : encoder->finish(symbols);
+            for (size_t s = 0; s < nSinks; s++) sinks[s]->symbols(symbols, k);
+            if (out) out->commit(k);
+            total += k;
+        }
+    }
+    for (size_t s = 0; s < nSinks; s++) sinks[s]->finish();
+    delete encoder;
+    return total;
+}
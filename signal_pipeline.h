@@ -0,0 +1,242 @@
+#ifndef SIGNAL_PIPELINE_H
+#define SIGNAL_PIPELINE_H
+
+// Source, modulator, line coder and sinks run a block at a time. Each stage
+// hands the next one block of a few thousand bits while it is still in L1
+// or L2, so a chain such as PCM into AMI with B8ZS into a file, statistics
+// and a palindrome search touches every sample, bit and symbol once; nothing
+// is kept for the whole stream unless a sink keeps it. The line coder is the
+// code's StreamEncoder, which also does the B8ZS/HDB3 substitutions, so the
+// scrambler is not a pass of its own.
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+#include "signal_core.h"
+#include "signal_io.h"
+#include "signal_source.h"
+
+// Bits per block, and so at most twice that in symbols: 64 KB of ints for
+// Manchester, half of a typical L2.
+const size_t pipelineBlockBits = 8192;
+
+// SAMPLES :-
+
+class SampleSource {
+public:
+    virtual ~SampleSource() {}
+    // Up to max further samples; 0 at the end of the input.
+    virtual size_t read(double* out, size_t max) = 0;
+};
+
+class GeneratedSamples : public SampleSource {
+public:
+    GeneratedSamples(AnalogSource& s) : source(s) {}
+    size_t read(double* out, size_t max) { return source.next(out, max); }
+
+private:
+    AnalogSource& source;
+};
+
+// Samples already in memory.
+class MemorySamples : public SampleSource {
+public:
+    MemorySamples(const double* s, size_t n) : samples(s), count(n) {}
+    size_t read(double* out, size_t max);
+
+private:
+    const double* samples;
+    size_t count;
+};
+
+// Whitespace-separated numbers; stops at the first thing that is not one.
+class TextSamples : public SampleSource {
+public:
+    TextSamples(std::istream& s) : in(s) {}
+    size_t read(double* out, size_t max);
+
+private:
+    std::istream& in;
+};
+
+// MODULATORS :-
+
+// Analog samples to bits, carrying state across blocks, and back again for
+// the SQNR. push() and finish() are handed an empty bits and return how many
+// they wrote; decode() writes one sample per bitsPerSample() bits, in order.
+class Modulator {
+public:
+    virtual ~Modulator() {}
+    virtual int bitsPerSample() const = 0;
+    virtual size_t push(const double* samples, size_t n, BitStream& bits) = 0;
+    virtual size_t finish(BitStream& bits) { (void)bits; return 0; }
+    virtual size_t decode(BitView bits, double* analog) = 0;
+};
+
+// Either constructor of PCMEncoder.
+class PCMModulator : public Modulator {
+public:
+    PCMModulator(int bitsPerSample, double minVal, double maxVal)
+        : encoder(bitsPerSample, minVal, maxVal), width(bitsPerSample) {}
+    PCMModulator(int bitsPerSample, size_t calibrationSamples)
+        : encoder(bitsPerSample, calibrationSamples), width(bitsPerSample) {}
+    int bitsPerSample() const { return width; }
+    size_t push(const double* samples, size_t n, BitStream& bits) { return encoder.push(samples, n, bits); }
+    size_t finish(BitStream& bits) { return encoder.finish(bits); }
+    size_t decode(BitView bits, double* analog) { return encoder.decode(bits, analog); }
+
+private:
+    PCMEncoder encoder;
+    int width;
+};
+
+// G.711 with the full scale fixed up front.
+class CompandedModulator : public Modulator {
+public:
+    CompandedModulator(Companding l, double scale) : law(l), fullScale(scale) {}
+    int bitsPerSample() const { return 8; }
+    size_t push(const double* samples, size_t n, BitStream& bits) {
+        return encodeCompanded(law, samples, n, bits, fullScale);
+    }
+    size_t decode(BitView bits, double* analog) { return decodeCompanded(law, bits, analog, fullScale); }
+
+private:
+    Companding law;
+    double fullScale;
+};
+
+// CVSD, and plain delta modulation as CVSD with its step pinned.
+class CVSDModulator : public Modulator {
+public:
+    CVSDModulator(const CVSDParams& p) : encoder(p), decoder(p) {}
+    int bitsPerSample() const { return 1; }
+    size_t push(const double* samples, size_t n, BitStream& bits) { return encoder.push(samples, n, bits); }
+    size_t decode(BitView bits, double* analog) { return decoder.push(bits, analog); }
+
+    // The fixed +/-0.5 step of encodeDeltaMod().
+    static CVSDParams deltaMod();
+
+private:
+    CVSDEncoder encoder;
+    CVSDDecoder decoder;
+};
+
+// Signal and error energy of samples against their decoded bits. Samples
+// wait until their bits arrive, which for calibrated PCM is after the
+// calibration block.
+class SQNRMeter {
+public:
+    SQNRMeter() : first(0), samples(0), signal(0.0), noise(0.0) {}
+
+    void original(const double* analog, size_t n);
+    void decoded(const double* analog, size_t n);
+    size_t count() const { return samples; }
+    // dB, as measureSQNR().
+    double value() const;
+
+private:
+    std::vector<double> waiting;
+    size_t first;
+    size_t samples;
+    double signal, noise;
+};
+
+// SOURCES :-
+
+// Bits a chunk at a time, in views owned by the source; false at the end.
+class BitSource {
+public:
+    virtual ~BitSource() {}
+    virtual bool next(BitView& chunk) = 0;
+};
+
+class ReaderBits : public BitSource {
+public:
+    ReaderBits(BitReader& r) : reader(r) {}
+    bool next(BitView& chunk) { return reader.next(chunk); }
+
+private:
+    BitReader& reader;
+};
+
+// Bits already in memory, as one chunk.
+class MemoryBits : public BitSource {
+public:
+    MemoryBits(BitView b) : bits(b), done(false) {}
+    bool next(BitView& chunk);
+
+private:
+    BitView bits;
+    bool done;
+};
+
+// Samples through a modulator, one block of samples per chunk. With a
+// meter, every block is also decoded again and compared.
+class ModulatedBits : public BitSource {
+public:
+    ModulatedBits(SampleSource& source, Modulator& modulator, SQNRMeter* meter = NULL);
+    bool next(BitView& chunk);
+    size_t samples() const { return total; }
+
+private:
+    SampleSource& source;
+    Modulator& modulator;
+    SQNRMeter* meter;
+    std::vector<double> analog, restored;
+    BitStream block;
+    size_t total;
+    bool ended;
+};
+
+// SINKS :-
+
+// Sees every bit and then every symbol the bits became, in order.
+class Sink {
+public:
+    virtual ~Sink() {}
+    virtual void bits(BitView block) { (void)block; }
+    virtual void symbols(const int* block, size_t n) { (void)block; (void)n; }
+    virtual void finish() {}
+};
+
+class StatsSink : public Sink {
+public:
+    StatsSink(LineCode code, SignalStats& stats) : tracker(code, stats) {}
+    void bits(BitView block) { tracker.pushBits(block); }
+    void symbols(const int* block, size_t n) { tracker.pushSymbols(block, n); }
+    void finish() { tracker.finish(); }
+
+private:
+    StatsTracker tracker;
+};
+
+class PalindromeSink : public Sink {
+public:
+    void bits(BitView block) { tracker.push(block); }
+    Palindrome longest() const { return tracker.longest(); }
+
+private:
+    PalindromeTracker tracker;
+};
+
+// Keeps the symbols packed, for plots and spectra of the whole stream.
+class PackSink : public Sink {
+public:
+    PackSink(LineCode code, SymbolStream& s) : packed(s) {
+        packed.clear();
+        packed.ternary = isTernary(code);
+    }
+    void symbols(const int* block, size_t n) { appendSymbols(block, n, packed); }
+
+private:
+    SymbolStream& packed;
+};
+
+// PIPELINE :-
+
+// Line codes everything from source, in blocks of pipelineBlockBits, and
+// hands each block to the sinks. With out, symbols are encoded straight
+// into its buffer and the sinks read them there. Returns the symbol count.
+size_t runPipeline(BitSource& source, LineCode code, SymbolWriter* out, const std::vector<Sink*>& sinks);
+
+#endif
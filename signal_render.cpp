@@ -0,0 +1,529 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include "signal_render.h"
+using namespace std;
+
+// LAYOUT :-
+
+// At most this many vertical divisions, however long the signal.
+static const int maxGridLines = 50;
+
+// Smallest 1, 2, 5, 10, 20... step that puts at most maxCount steps in span.
+// A double, so it holds the step for any length of signal.
+static double niceStep(double span, int maxCount) {
+    for (double scale = 1; ; scale *= 10) {
+        if (span / scale <= maxCount) return scale;
+        if (span / (2 * scale) <= maxCount) return 2 * scale;
+        if (span / (5 * scale) <= maxCount) return 5 * scale;
+    }
+}
+
+// Symbols [first, end) are at least partly in view.
+static void visibleRange(const PlotView& view, size_t& first, size_t& end) {
+    first = (size_t)view.first;
+    end = min(view.symbols->size(), (size_t)ceil(view.first + view.span));
+}
+
+void drawPlotBackground(Canvas& canvas, const PlotView& view) {
+    const float yScale = plotYScale;
+    size_t n = view.symbols->size(), first, end;
+    visibleRange(view, first, end);
+
+    // Title
+    canvas.color(0.0f, 0.0f, 0.0f);
+    canvas.text(-0.95f, 0.92f, view.title, true);
+
+    // Visible range, once zoomed in
+    if (end - first < n) {
+        SymbolSummary sum = view.pyramid->summarize(first, end - first);
+        char info[128];
+        snprintf(info, sizeof(info), "Symbols %llu-%llu of %llu, %llu transitions",
+                 (unsigned long long)first, (unsigned long long)end,
+                 (unsigned long long)n, (unsigned long long)sum.transitions);
+        canvas.color(0.3f, 0.3f, 0.3f);
+        canvas.text(0.3f, 0.92f, info, false);
+    }
+
+    // Axes
+    canvas.color(0.0f, 0.0f, 0.0f);
+    canvas.lineWidth(2.5f);
+    canvas.line(-0.9f, 0.0f, 0.9f, 0.0f);
+    canvas.line(-0.9f, -0.8f, -0.9f, 0.8f);
+
+    // Grid lines
+    canvas.color(0.7f, 0.7f, 0.7f);
+    canvas.lineWidth(1.0f);
+    canvas.line(-0.9f, 1.0f * yScale, 0.9f, 1.0f * yScale);
+    canvas.line(-0.9f, -1.0f * yScale, 0.9f, -1.0f * yScale);
+
+    // Vertical divisions, every gridStep-th symbol in view
+    double viewEnd = view.first + view.span;
+    double gridStep = niceStep(view.span, maxGridLines);
+    canvas.color(0.88f, 0.88f, 0.88f);
+    canvas.lineWidth(0.5f);
+    for (double i = ceil(view.first / gridStep) * gridStep; i <= viewEnd; i += gridStep) {
+        float x = view.x(i);
+        canvas.line(x, -0.8f, x, 0.8f);
+    }
+
+    // Y-axis labels
+    canvas.color(0.0f, 0.0f, 0.0f);
+    canvas.text(-0.99f, 1.0f * yScale - 0.02f, "+1", false);
+    canvas.text(-0.97f, -0.03f, "0", false);
+    canvas.text(-0.99f, -1.0f * yScale - 0.02f, "-1", false);
+
+    // X-axis labels and info
+    double visible = ceil(view.span);
+    double labelStep = 1;
+    if (view.manchester) {
+        if (visible > 40) labelStep = 4;
+        else if (visible > 20) labelStep = 2;
+        if (gridStep > 1) labelStep = gridStep * 5;
+
+        for (double i = ceil(view.first / labelStep) * labelStep; i <= viewEnd; i += labelStep) {
+            char label[24];
+            snprintf(label, sizeof(label), "%.1f", i * 0.5);
+            canvas.text(view.x(i) - 0.02f, -0.88f, label, false);
+        }
+
+        canvas.color(0.5f, 0.0f, 0.5f);
+        canvas.text(-0.3f, -0.95f, "Bit Position (mid-transitions at 0.5, 1.5, 2.5...)", false);
+    } else {
+        if (visible > 30) labelStep = 5;
+        else if (visible > 15) labelStep = 2;
+        if (gridStep > 1) labelStep = gridStep * 5;
+
+        for (double i = ceil(view.first / labelStep) * labelStep; i <= viewEnd; i += labelStep) {
+            char label[24];
+            snprintf(label, sizeof(label), "%.0f", i);
+            canvas.text(view.x(i) - 0.015f, -0.88f, label, false);
+        }
+
+        canvas.color(0.0f, 0.0f, 0.0f);
+        canvas.text(-0.08f, -0.95f, "Bit Position", false);
+    }
+
+    // Voltage label
+    canvas.color(0.0f, 0.0f, 0.0f);
+    canvas.text(-0.99f, 0.85f, "Voltage", false);
+}
+
+void drawPlotValues(Canvas& canvas, const PlotView& view) {
+    if (view.span > 25) return;
+    size_t first, end;
+    visibleRange(view, first, end);
+    canvas.color(0.6f, 0.0f, 0.0f);
+    for (size_t i = first; i < end; i++) {
+        float x = view.x(i + 0.5) - 0.015f;
+        if (x < -0.9f || x > 0.9f) continue;
+        int level = view.symbols->get(i);
+        float y = level * plotYScale;
+
+        if (level == 1) canvas.text(x, y + 0.08f, "+1", false);
+        else if (level == -1) canvas.text(x, y - 0.12f, "-1", false);
+        else canvas.text(x, y + 0.05f, "0", false);
+    }
+}
+
+// Past one symbol per column, each column's envelope is widened by the
+// symbol before it, so a transition on a column edge still shows, and is
+// followed by a flat segment at the column's last level.
+void buildPlotTrace(const PlotView& view, vector<float>& vertices, bool& strip) {
+    const SymbolStream& s = *view.symbols;
+    const float yScale = plotYScale;
+    size_t n = s.size(), columns = max(1, view.columns), first, end;
+    visibleRange(view, first, end);
+    vertices.clear();
+
+    strip = end - first <= columns;
+    if (strip) {
+        for (size_t i = first; i < end; i++) {
+            float y = s.get(i) * yScale;
+            vertices.push_back(max(-0.9f, view.x(i)));
+            vertices.push_back(y);
+            vertices.push_back(min(0.9f, view.x(i + 1)));
+            vertices.push_back(y);
+        }
+        return;
+    }
+
+    float xStep = 1.8f / columns;
+    double perColumn = view.span / columns;
+    for (size_t c = 0; c < columns; c++) {
+        size_t a = (size_t)(view.first + c * perColumn);
+        size_t b = min(n, (size_t)(view.first + (c + 1) * perColumn));
+        if (b <= a) continue;
+        SymbolSummary sum = view.pyramid->summarize(a, b - a);
+        if (a > 0) {
+            int before = s.get(a - 1);
+            sum.lo = min(sum.lo, before);
+            sum.hi = max(sum.hi, before);
+        }
+        float x = -0.9f + c * xStep;
+        float y = s.get(b - 1) * yScale;
+        float segment[8] = { x, sum.lo * yScale, x, sum.hi * yScale, x, y, x + xStep, y };
+        vertices.insert(vertices.end(), segment, segment + 8);
+    }
+}
+
+// 1, 2 or 5 times a power of ten, the smallest with at most maxCount
+// steps in span.
+static double niceInterval(double span, int maxCount) {
+    double scale = pow(10.0, floor(log10(span / maxCount)));
+    if (span / scale <= maxCount) return scale;
+    if (span / (2 * scale) <= maxCount) return 2 * scale;
+    if (span / (5 * scale) <= maxCount) return 5 * scale;
+    return 10 * scale;
+}
+
+void drawSpectrum(Canvas& canvas, const Spectrum& spectrum, const char* title,
+                  const char* unit, double range) {
+    const float left = -0.85f, right = 0.9f, bottom = -0.75f, top = 0.8f;
+    const vector<double>& d = spectrum.density;
+
+    canvas.color(0.0f, 0.0f, 0.0f);
+    canvas.text(-0.95f, 0.92f, title, true);
+    if (d.size() < 2) return;
+
+    double peak = *max_element(d.begin(), d.end());
+    double ceiling = peak > 0.0 ? ceil(10.0 * log10(peak) / 10.0) * 10.0 : 0.0;
+    double floorDB = ceiling - range;
+    double fMax = spectrum.frequency.back();
+    auto x = [&](double f) { return left + (float)(f / fMax) * (right - left); };
+    auto y = [&](double v) {
+        double db = v > 0.0 ? 10.0 * log10(v) : floorDB;
+        return bottom + (float)((max(db, floorDB) - floorDB) / range) * (top - bottom);
+    };
+
+    // Grid and labels: every 10 dB, and a 1-2-5 step in frequency.
+    char label[48];
+    canvas.lineWidth(0.5f);
+    for (double db = floorDB; db <= ceiling + 1e-9; db += 10.0) {
+        float yy = bottom + (float)((db - floorDB) / range) * (top - bottom);
+        canvas.color(0.88f, 0.88f, 0.88f);
+        canvas.line(left, yy, right, yy);
+        snprintf(label, sizeof(label), "%.0f", db);
+        canvas.color(0.0f, 0.0f, 0.0f);
+        canvas.text(-0.99f, yy - 0.01f, label, false);
+    }
+    double step = niceInterval(fMax, 10);
+    for (double f = 0.0; f <= fMax * (1 + 1e-9); f += step) {
+        canvas.color(0.88f, 0.88f, 0.88f);
+        canvas.line(x(f), bottom, x(f), top);
+        snprintf(label, sizeof(label), "%g", f);
+        canvas.color(0.0f, 0.0f, 0.0f);
+        canvas.text(x(f) - 0.015f, bottom - 0.08f, label, false);
+    }
+
+    // Axes
+    canvas.color(0.0f, 0.0f, 0.0f);
+    canvas.lineWidth(2.5f);
+    canvas.line(left, bottom, right, bottom);
+    canvas.line(left, bottom, left, top);
+    canvas.text(-0.99f, 0.85f, "PSD (dB)", false);
+    snprintf(label, sizeof(label), "Frequency (%s)", unit);
+    canvas.text(-0.1f, -0.95f, label, false);
+
+    char info[96];
+    snprintf(info, sizeof(info), "Welch, %llu segments of %llu samples",
+             (unsigned long long)spectrum.segments, (unsigned long long)(2 * (d.size() - 1)));
+    canvas.color(0.3f, 0.3f, 0.3f);
+    canvas.text(0.3f, 0.92f, info, false);
+
+    canvas.color(0.0f, 0.0f, 1.0f);
+    canvas.lineWidth(2.0f);
+    for (size_t k = 1; k < d.size(); k++) {
+        canvas.line(x(spectrum.frequency[k - 1]), y(d[k - 1]), x(spectrum.frequency[k]), y(d[k]));
+    }
+}
+
+// RASTER :-
+
+// 5x8 glyphs for ASCII 32..126, one byte per column, bit 0 the top row. Rows
+// 0..6 sit on the baseline and row 7 holds descenders.
+static const unsigned char font5x8[95][5] = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00},
+    {0x14,0x7F,0x14,0x7F,0x14}, {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62},
+    {0x36,0x49,0x56,0x20,0x50}, {0x00,0x08,0x07,0x03,0x00}, {0x00,0x1C,0x22,0x41,0x00},
+    {0x00,0x41,0x22,0x1C,0x00}, {0x2A,0x1C,0x7F,0x1C,0x2A}, {0x08,0x08,0x3E,0x08,0x08},
+    {0x00,0x80,0x70,0x30,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x00,0x60,0x60,0x00},
+    {0x20,0x10,0x08,0x04,0x02}, {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00},
+    {0x72,0x49,0x49,0x49,0x46}, {0x21,0x41,0x49,0x4D,0x33}, {0x18,0x14,0x12,0x7F,0x10},
+    {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x31}, {0x41,0x21,0x11,0x09,0x07},
+    {0x36,0x49,0x49,0x49,0x36}, {0x46,0x49,0x49,0x29,0x1E}, {0x00,0x00,0x14,0x00,0x00},
+    {0x00,0x40,0x34,0x00,0x00}, {0x00,0x08,0x14,0x22,0x41}, {0x14,0x14,0x14,0x14,0x14},
+    {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x59,0x09,0x06}, {0x3E,0x41,0x5D,0x59,0x4E},
+    {0x7C,0x12,0x11,0x12,0x7C}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+    {0x7F,0x41,0x41,0x41,0x3E}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01},
+    {0x3E,0x41,0x41,0x51,0x73}, {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00},
+    {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, {0x7F,0x40,0x40,0x40,0x40},
+    {0x7F,0x02,0x1C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46},
+    {0x26,0x49,0x49,0x49,0x32}, {0x03,0x01,0x7F,0x01,0x03}, {0x3F,0x40,0x40,0x40,0x3F},
+    {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, {0x63,0x14,0x08,0x14,0x63},
+    {0x03,0x04,0x78,0x04,0x03}, {0x61,0x59,0x49,0x4D,0x43}, {0x00,0x7F,0x41,0x41,0x41},
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x41,0x7F}, {0x04,0x02,0x01,0x02,0x04},
+    {0x40,0x40,0x40,0x40,0x40}, {0x00,0x03,0x07,0x08,0x00}, {0x20,0x54,0x54,0x78,0x40},
+    {0x7F,0x28,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x28}, {0x38,0x44,0x44,0x28,0x7F},
+    {0x38,0x54,0x54,0x54,0x18}, {0x00,0x08,0x7E,0x09,0x02}, {0x18,0xA4,0xA4,0x9C,0x78},
+    {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x40,0x3D,0x00},
+    {0x7F,0x10,0x28,0x44,0x00}, {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x78,0x04,0x78},
+    {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38}, {0xFC,0x18,0x24,0x24,0x18},
+    {0x18,0x24,0x24,0x18,0xFC}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x24},
+    {0x04,0x04,0x3F,0x44,0x24}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C},
+    {0x3C,0x40,0x30,0x40,0x3C}, {0x44,0x28,0x10,0x28,0x44}, {0x4C,0x90,0x90,0x90,0x7C},
+    {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00}, {0x00,0x00,0x77,0x00,0x00},
+    {0x00,0x41,0x36,0x08,0x00}, {0x02,0x01,0x02,0x04,0x02}
+};
+
+// Plots into an Image. Lines are stamped with a square pen of the current
+// width; text uses the font above, doubled in size for bold.
+class RasterCanvas : public Canvas {
+public:
+    RasterCanvas(Image& target) : image(target), pen(1) {
+        rgb[0] = rgb[1] = rgb[2] = 0;
+    }
+
+    void color(float r, float g, float b) {
+        rgb[0] = (unsigned char)(r * 255 + 0.5f);
+        rgb[1] = (unsigned char)(g * 255 + 0.5f);
+        rgb[2] = (unsigned char)(b * 255 + 0.5f);
+    }
+
+    void lineWidth(float width) {
+        pen = max(1, (int)(width + 0.5f));
+    }
+
+    void line(float x0, float y0, float x1, float y1) {
+        int px0 = toX(x0), py0 = toY(y0), px1 = toX(x1), py1 = toY(y1);
+        int dx = abs(px1 - px0), dy = -abs(py1 - py0);
+        int sx = px0 < px1 ? 1 : -1, sy = py0 < py1 ? 1 : -1;
+        int err = dx + dy;
+        for (;;) {
+            stamp(px0, py0);
+            if (px0 == px1 && py0 == py1) break;
+            int e2 = 2 * err;
+            if (e2 >= dy) { err += dy; px0 += sx; }
+            if (e2 <= dx) { err += dx; py0 += sy; }
+        }
+    }
+
+    void text(float x, float y, const char* str, bool bold) {
+        int scale = bold ? 2 : 1;
+        int px = toX(x), baseline = toY(y);
+        for (; *str; str++, px += 6 * scale) {
+            unsigned char c = (unsigned char)*str;
+            if (c < 32 || c > 126) continue;
+            const unsigned char* glyph = font5x8[c - 32];
+            for (int col = 0; col < 5; col++) {
+                for (int row = 0; row < 8; row++) {
+                    if (!(glyph[col] >> row & 1)) continue;
+                    int top = baseline - (6 - row) * scale;
+                    for (int yy = 0; yy < scale; yy++)
+                        for (int xx = 0; xx < scale; xx++) plot(px + col * scale + xx, top + yy);
+                }
+            }
+        }
+    }
+
+private:
+    Image& image;
+    unsigned char rgb[3];
+    int pen;
+
+    int toX(float x) const { return (int)floor((x + 1.0f) * 0.5f * image.width); }
+    int toY(float y) const { return (int)floor((1.0f - y) * 0.5f * image.height); }
+
+    void plot(int x, int y) {
+        if (x < 0 || y < 0 || x >= image.width || y >= image.height) return;
+        unsigned char* p = &image.rgb[((size_t)y * image.width + x) * 3];
+        p[0] = rgb[0];
+        p[1] = rgb[1];
+        p[2] = rgb[2];
+    }
+
+    void stamp(int x, int y) {
+        int lo = -(pen - 1) / 2, hi = pen / 2;
+        for (int yy = lo; yy <= hi; yy++)
+            for (int xx = lo; xx <= hi; xx++) plot(x + xx, y + yy);
+    }
+};
+
+void renderPlot(const PlotView& view, int width, int height, Image& image) {
+    image.width = width;
+    image.height = height;
+    image.rgb.assign((size_t)width * height * 3, 255);
+
+    RasterCanvas canvas(image);
+    drawPlotBackground(canvas, view);
+
+    vector<float> trace;
+    bool strip;
+    buildPlotTrace(view, trace, strip);
+    canvas.color(0.0f, 0.0f, 1.0f);
+    canvas.lineWidth(3.0f);
+    size_t step = strip ? 2 : 4;
+    for (size_t v = 0; v + 3 < trace.size(); v += step) {
+        canvas.line(trace[v], trace[v + 1], trace[v + 2], trace[v + 3]);
+    }
+
+    drawPlotValues(canvas, view);
+}
+
+void renderSpectrum(const Spectrum& spectrum, const char* title, const char* unit,
+                    int width, int height, Image& image) {
+    image.width = width;
+    image.height = height;
+    image.rgb.assign((size_t)width * height * 3, 255);
+    RasterCanvas canvas(image);
+    drawSpectrum(canvas, spectrum, title, unit);
+}
+
+bool writePPM(const Image& image, const string& path) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", image.width, image.height);
+    fwrite(image.rgb.data(), 1, image.rgb.size(), f);
+    return fclose(f) == 0;
+}
+
+struct CrcTable {
+    uint32_t entries[256];
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+static uint32_t crc32(const unsigned char* data, size_t n) {
+    static const CrcTable table;   // built once, safely, by whichever thread gets here first
+    uint32_t crc = ~0u;
+    for (size_t i = 0; i < n; i++) crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putBig32(vector<unsigned char>& out, uint32_t v) {
+    out.push_back((unsigned char)(v >> 24));
+    out.push_back((unsigned char)(v >> 16));
+    out.push_back((unsigned char)(v >> 8));
+    out.push_back((unsigned char)v);
+}
+
+static void putChunk(FILE* f, const char* type, const vector<unsigned char>& data) {
+    vector<unsigned char> chunk;
+    putBig32(chunk, (uint32_t)data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putBig32(chunk, crc32(&chunk[4], chunk.size() - 4));
+    fwrite(chunk.data(), 1, chunk.size(), f);
+}
+
+bool writePNG(const Image& image, const string& path) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    fwrite(signature, 1, 8, f);
+
+    vector<unsigned char> header;
+    putBig32(header, (uint32_t)image.width);
+    putBig32(header, (uint32_t)image.height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // RGB
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    putChunk(f, "IHDR", header);
+
+    // Each row is a filter byte (0, none) and the pixels, carried in stored
+    // deflate blocks of up to 65535 bytes inside a zlib stream.
+    size_t rowBytes = (size_t)image.width * 3;
+    vector<unsigned char> raw;
+    raw.reserve((rowBytes + 1) * image.height);
+    for (int y = 0; y < image.height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), image.rgb.begin() + y * rowBytes, image.rgb.begin() + (y + 1) * rowBytes);
+    }
+    vector<unsigned char> z;
+    z.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    z.push_back(0x78);
+    z.push_back(0x01);
+    size_t at = 0;
+    do {
+        size_t len = min((size_t)65535, raw.size() - at);
+        z.push_back(at + len == raw.size() ? 1 : 0);
+        z.push_back((unsigned char)len);
+        z.push_back((unsigned char)(len >> 8));
+        z.push_back((unsigned char)~len);
+        z.push_back((unsigned char)(~len >> 8));
+        z.insert(z.end(), raw.begin() + at, raw.begin() + at + len);
+        at += len;
+    } while (at < raw.size());
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < raw.size(); i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBig32(z, (b << 16) | a);
+    putChunk(f, "IDAT", z);
+    putChunk(f, "IEND", vector<unsigned char>());
+    return fclose(f) == 0;
+}
+
+bool writeImage(const Image& image, const string& path) {
+    size_t dot = path.rfind('.');
+    if (dot != string::npos && path.substr(dot) == ".ppm") return writePPM(image, path);
+    return writePNG(image, path);
+}
+
+// BATCH :-
+
+static bool renderJob(const RenderJob& job, BitFormat format, LineCode code, int width, int height) {
+    BitReader reader;
+    if (!reader.open(job.input.c_str(), format)) return false;
+    BitStream bits;
+    BitView chunk(NULL, 0);
+    while (reader.next(chunk)) {
+        size_t at = bits.size();
+        bits.resize(at + chunk.size());
+        memcpy(bits.words.data() + at / 64, chunk.words, (chunk.size() + 63) / 64 * sizeof(uint64_t));
+    }
+    if (bits.size() == 0) return false;
+
+    SymbolStream symbols;
+    encodeSymbols(code, bits, symbols);
+    SymbolPyramid pyramid;
+    pyramid.build(symbols);
+
+    PlotView view = { &symbols, &pyramid, job.title.c_str(), symbolsPerBit(code) == 2,
+                      0.0, (double)symbols.size(), (int)(width * 0.9f) };
+    Image image;
+    renderPlot(view, width, height, image);
+    return writeImage(image, job.output);
+}
+
+size_t renderBatch(const vector<RenderJob>& jobs, BitFormat format, LineCode code,
+                   int width, int height, unsigned threads) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    threads = (unsigned)min((size_t)threads, jobs.size());
+    atomic<size_t> next(0), written(0);
+
+    // Workers take jobs one at a time, so a few long signals don't hold up
+    // the rest.
+    vector<thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.push_back(thread([&]() {
+            for (size_t j = next++; j < jobs.size(); j = next++) {
+                if (renderJob(jobs[j], format, code, width, height)) written++;
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+    return written;
+}
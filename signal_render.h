@@ -0,0 +1,91 @@
+#ifndef SIGNAL_RENDER_H
+#define SIGNAL_RENDER_H
+
+// Waveform plot layout shared by the GLUT window and the offscreen renderer,
+// and a CPU rasteriser that turns it into PPM or PNG files with no display
+// server. Coordinates are the window's: x and y in [-1, 1], y up.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "signal_core.h"
+#include "signal_io.h"
+#include "signal_spectrum.h"
+
+// LAYOUT :-
+
+class Canvas {
+public:
+    virtual ~Canvas() {}
+    virtual void color(float r, float g, float b) = 0;
+    virtual void lineWidth(float width) = 0;
+    virtual void line(float x0, float y0, float x1, float y1) = 0;
+    // (x, y) is the left end of the baseline.
+    virtual void text(float x, float y, const char* text, bool bold) = 0;
+};
+
+const float plotYScale = 0.35f;
+
+// What to plot: symbols [first, first + span) across x in [-0.9, 0.9],
+// which is `columns` pixels wide. The pyramid summarises decimated columns.
+struct PlotView {
+    const SymbolStream* symbols;
+    const SymbolPyramid* pyramid;
+    const char* title;
+    bool manchester;
+    double first, span;
+    int columns;
+
+    float x(double i) const {
+        return (float)(-0.9 + (i - first) * 1.8 / span);
+    }
+};
+
+// Title, axes, grid and axis labels, drawn under the trace.
+void drawPlotBackground(Canvas& canvas, const PlotView& view);
+// Per-symbol value labels, drawn over the trace once few enough are in view.
+void drawPlotValues(Canvas& canvas, const PlotView& view);
+
+// The trace as x, y pairs: a line strip (strip = true) with two vertices
+// per symbol up to one symbol per column, otherwise separate line segments
+// giving each column's min/max envelope, so the count is O(columns).
+void buildPlotTrace(const PlotView& view, std::vector<float>& vertices, bool& strip);
+
+// Spectrum plot: density in dB, from the peak down `range` dB, against
+// frequency in `unit` from 0 to the top bin.
+void drawSpectrum(Canvas& canvas, const Spectrum& spectrum, const char* title,
+                  const char* unit, double range = 60.0);
+
+// RASTER :-
+
+struct Image {
+    int width, height;
+    std::vector<unsigned char> rgb;   // rows top to bottom, 3 bytes per pixel
+};
+
+// The view laid out as the window shows it, at width x height pixels.
+void renderPlot(const PlotView& view, int width, int height, Image& image);
+
+void renderSpectrum(const Spectrum& spectrum, const char* title, const char* unit,
+                    int width, int height, Image& image);
+
+bool writePPM(const Image& image, const std::string& path);
+// Uncompressed (stored) deflate, so no zlib is needed.
+bool writePNG(const Image& image, const std::string& path);
+// PPM for a .ppm extension, PNG otherwise.
+bool writeImage(const Image& image, const std::string& path);
+
+// BATCH :-
+
+struct RenderJob {
+    std::string input;
+    std::string output;
+    std::string title;
+};
+
+// Reads, encodes and renders every job's input on `threads` workers (0 uses
+// every core). Returns the number of images written.
+size_t renderBatch(const std::vector<RenderJob>& jobs, BitFormat format, LineCode code,
+                   int width, int height, unsigned threads = 0);
+
+#endif
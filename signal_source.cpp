@@ -0,0 +1,197 @@
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "signal_source.h"
+#include "signal_core.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIGNAL_X86 1
+#endif
+using namespace std;
+
+bool parseWaveform(const char* name, Waveform& wave) {
+    if (strcmp(name, "sine") == 0) wave = WAVE_SINE;
+    else if (strcmp(name, "multitone") == 0) wave = WAVE_MULTITONE;
+    else if (strcmp(name, "chirp") == 0) wave = WAVE_CHIRP;
+    else if (strcmp(name, "square") == 0) wave = WAVE_SQUARE;
+    else if (strcmp(name, "gaussian") == 0) wave = WAVE_GAUSSIAN;
+    else if (strcmp(name, "uniform") == 0) wave = WAVE_UNIFORM;
+    else return false;
+    return true;
+}
+
+bool validSource(const SourceParams& params) {
+    double n = params.sampleRate * params.duration;
+    if (!(params.sampleRate > 0.0 && params.duration > 0.0 && n < 9e18)) return false;
+    if (params.wave != WAVE_MULTITONE) return true;
+    for (size_t t = 0; t < params.tones.size(); t++) {
+        if (!(params.tones[t] > 0.0)) return false;
+    }
+    return !params.tones.empty();
+}
+
+//SINE KERNELS:-
+
+// x is reduced to r in [-1/2, 1/2] turns by subtracting round(x), which
+// adding and removing 1.5 * 2^52 does without a rounding instruction; r is
+// folded into [-1/4, 1/4] with sin(pi - a) = sin(a), and the Taylor series
+// to the 19th power is exact to double precision over that quarter turn.
+// Every path does the same operations in the same order, so the output is
+// the same whichever kernel runs.
+
+static const double roundMagic = 6755399441055744.0;
+static const double twoPi = 6.283185307179586;
+static const double sineTerms[9] = {
+    -1.0 / 6.0, 1.0 / 120.0, -1.0 / 5040.0, 1.0 / 362880.0, -1.0 / 39916800.0,
+    1.0 / 6227020800.0, -1.0 / 1307674368000.0, 1.0 / 355687428096000.0,
+    -1.0 / 121645100408832000.0
+};
+
+static void sineTurnsScalar(const double* turns, size_t n, double* out) {
+    for (size_t i = 0; i < n; i++) {
+        double x = turns[i];
+        double r = x - ((x + roundMagic) - roundMagic);
+        if (fabs(r) > 0.25) r = copysign(0.5, r) - r;
+        double a = r * twoPi, a2 = a * a;
+        double p = sineTerms[8];
+        for (int k = 7; k >= 0; k--) p = p * a2 + sineTerms[k];
+        out[i] = a + a * a2 * p;
+    }
+}
+
+#ifdef SIGNAL_X86
+
+__attribute__((target("sse2")))
+static void sineTurnsSSE2(const double* turns, size_t n, double* out) {
+    size_t full = n & ~(size_t)1;
+    const __m128d magic = _mm_set1_pd(roundMagic), quarter = _mm_set1_pd(0.25);
+    const __m128d half = _mm_set1_pd(0.5), sign = _mm_set1_pd(-0.0);
+    for (size_t i = 0; i < full; i += 2) {
+        __m128d x = _mm_loadu_pd(turns + i);
+        __m128d r = _mm_sub_pd(x, _mm_sub_pd(_mm_add_pd(x, magic), magic));
+        __m128d fold = _mm_cmpgt_pd(_mm_andnot_pd(sign, r), quarter);
+        __m128d mirrored = _mm_sub_pd(_mm_or_pd(_mm_and_pd(sign, r), half), r);
+        r = _mm_or_pd(_mm_and_pd(fold, mirrored), _mm_andnot_pd(fold, r));
+        __m128d a = _mm_mul_pd(r, _mm_set1_pd(twoPi)), a2 = _mm_mul_pd(a, a);
+        __m128d p = _mm_set1_pd(sineTerms[8]);
+        for (int k = 7; k >= 0; k--) p = _mm_add_pd(_mm_mul_pd(p, a2), _mm_set1_pd(sineTerms[k]));
+        _mm_storeu_pd(out + i, _mm_add_pd(a, _mm_mul_pd(_mm_mul_pd(a, a2), p)));
+    }
+    sineTurnsScalar(turns + full, n - full, out + full);
+}
+
+__attribute__((target("avx2")))
+static void sineTurnsAVX2(const double* turns, size_t n, double* out) {
+    size_t full = n & ~(size_t)3;
+    const __m256d magic = _mm256_set1_pd(roundMagic), quarter = _mm256_set1_pd(0.25);
+    const __m256d half = _mm256_set1_pd(0.5), sign = _mm256_set1_pd(-0.0);
+    for (size_t i = 0; i < full; i += 4) {
+        __m256d x = _mm256_loadu_pd(turns + i);
+        __m256d r = _mm256_sub_pd(x, _mm256_sub_pd(_mm256_add_pd(x, magic), magic));
+        __m256d fold = _mm256_cmp_pd(_mm256_andnot_pd(sign, r), quarter, _CMP_GT_OQ);
+        __m256d mirrored = _mm256_sub_pd(_mm256_or_pd(_mm256_and_pd(sign, r), half), r);
+        r = _mm256_blendv_pd(r, mirrored, fold);
+        __m256d a = _mm256_mul_pd(r, _mm256_set1_pd(twoPi)), a2 = _mm256_mul_pd(a, a);
+        __m256d p = _mm256_set1_pd(sineTerms[8]);
+        for (int k = 7; k >= 0; k--) p = _mm256_add_pd(_mm256_mul_pd(p, a2), _mm256_set1_pd(sineTerms[k]));
+        _mm256_storeu_pd(out + i, _mm256_add_pd(a, _mm256_mul_pd(_mm256_mul_pd(a, a2), p)));
+    }
+    // The libm calls that follow are SSE code; leaving the upper halves
+    // dirty makes each of them pay the AVX/SSE transition.
+    _mm256_zeroupper();
+    sineTurnsScalar(turns + full, n - full, out + full);
+}
+
+#endif
+
+// Picked on every call, so setSimdLevel() reaches it like the core kernels.
+void sineTurns(const double* turns, size_t n, double* out) {
+#ifdef SIGNAL_X86
+    pickKernel(sineTurnsAVX2, sineTurnsSSE2, sineTurnsScalar)(turns, n, out);
+#else
+    sineTurnsScalar(turns, n, out);
+#endif
+}
+
+//SOURCES:-
+
+static const size_t sourceBlock = 4096;
+
+// The top 53 bits of a draw as a double in [0, 1).
+static inline double unitInterval(uint64_t x) {
+    return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+AnalogSource::AnalogSource(const SourceParams& p)
+    : params(p), position(0), rng(p.seed) {
+    double n = p.sampleRate > 0.0 && p.duration > 0.0 ? floor(p.sampleRate * p.duration + 0.5) : 0.0;
+    count = (size_t)n;
+    phase.resize(sourceBlock);
+}
+
+size_t AnalogSource::next(double* out, size_t max) {
+    size_t produced = 0;
+    double* turns = phase.data();
+    double amp = params.amplitude;
+
+    while (produced < max && position < count) {
+        size_t k = min(min(max - produced, count - position), sourceBlock);
+        double first = (double)position;
+        double* dst = out + produced;
+
+        switch (params.wave) {
+            case WAVE_SINE:
+            case WAVE_SQUARE: {
+                double perSample = params.frequency / params.sampleRate;
+                for (size_t i = 0; i < k; i++) turns[i] = perSample * (first + i);
+                if (params.wave == WAVE_SQUARE) {
+                    for (size_t i = 0; i < k; i++) dst[i] = turns[i] - floor(turns[i]) < 0.5 ? amp : -amp;
+                } else {
+                    sineTurns(turns, k, dst);
+                    for (size_t i = 0; i < k; i++) dst[i] *= amp;
+                }
+                break;
+            }
+            case WAVE_MULTITONE: {
+                fill(dst, dst + k, 0.0);
+                double each = params.tones.empty() ? 0.0 : amp / params.tones.size();
+                for (size_t t = 0; t < params.tones.size(); t++) {
+                    double perSample = params.tones[t] / params.sampleRate;
+                    for (size_t i = 0; i < k; i++) turns[i] = perSample * (first + i);
+                    sineTurns(turns, k, turns);
+                    for (size_t i = 0; i < k; i++) dst[i] += each * turns[i];
+                }
+                break;
+            }
+            case WAVE_CHIRP: {
+                // Linear sweep: the phase in turns is f0 t + (f1 - f0) t^2 / 2T.
+                double f0 = params.frequency;
+                double sweep = (params.endFrequency - f0) / (2.0 * params.duration);
+                for (size_t i = 0; i < k; i++) {
+                    double t = (first + i) / params.sampleRate;
+                    turns[i] = (f0 + sweep * t) * t;
+                }
+                sineTurns(turns, k, dst);
+                for (size_t i = 0; i < k; i++) dst[i] *= amp;
+                break;
+            }
+            case WAVE_GAUSSIAN:
+                // Box-Muller, keeping only the sine half so every sample
+                // takes exactly two draws and blocks can split anywhere.
+                for (size_t i = 0; i < k; i++) {
+                    dst[i] = 1.0 - unitInterval(rng());
+                    turns[i] = unitInterval(rng());
+                }
+                for (size_t i = 0; i < k; i++) dst[i] = amp * sqrt(-2.0 * log(dst[i]));
+                sineTurns(turns, k, turns);
+                for (size_t i = 0; i < k; i++) dst[i] *= turns[i];
+                break;
+            case WAVE_UNIFORM:
+                for (size_t i = 0; i < k; i++) dst[i] = amp * (2.0 * unitInterval(rng()) - 1.0);
+                break;
+        }
+        produced += k;
+        position += k;
+    }
+    return produced;
+}
@@ -0,0 +1,57 @@
+#ifndef SIGNAL_SOURCE_H
+#define SIGNAL_SOURCE_H
+
+// Synthetic analog inputs for the modulators: tones, sweeps, square waves
+// and seeded noise at a given sample rate and duration. Sources are read a
+// block at a time, so a long run never holds all of its samples at once.
+
+#include <cstddef>
+#include <random>
+#include <vector>
+#include <stdint.h>
+
+enum Waveform { WAVE_SINE, WAVE_MULTITONE, WAVE_CHIRP, WAVE_SQUARE, WAVE_GAUSSIAN, WAVE_UNIFORM };
+
+bool parseWaveform(const char* name, Waveform& wave);
+
+struct SourceParams {
+    Waveform wave;
+    double sampleRate;          // samples per second
+    double duration;            // seconds
+    double amplitude;           // peak; the standard deviation for Gaussian noise
+    double frequency;           // Hz; where a chirp starts
+    double endFrequency;        // Hz; where a chirp ends
+    std::vector<double> tones;  // Hz, for WAVE_MULTITONE, each at amplitude / count
+    uint64_t seed;              // noise only
+
+    SourceParams()
+        : wave(WAVE_SINE), sampleRate(8000.0), duration(1.0), amplitude(1.0),
+          frequency(440.0), endFrequency(3400.0), seed(1) {}
+};
+
+// sin(2 pi x) for x in turns, vectorised. Agrees with the libm sin to about
+// 1e-15 for |x| below 2^50.
+void sineTurns(const double* turns, size_t n, double* out);
+
+// False for a rate or duration that is not positive, a sample count too
+// large to hold, or a multitone with no tones or one at or below 0 Hz, which
+// would only ever give silence.
+bool validSource(const SourceParams& params);
+
+class AnalogSource {
+public:
+    AnalogSource(const SourceParams& params);
+
+    size_t total() const { return count; }
+    // Up to max further samples; 0 once all total() have been produced. The
+    // samples do not depend on how the run is split into blocks.
+    size_t next(double* out, size_t max);
+
+private:
+    SourceParams params;
+    size_t count, position;
+    std::vector<double> phase;
+    std::mt19937_64 rng;
+};
+
+#endif
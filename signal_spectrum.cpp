@@ -0,0 +1,432 @@
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include "signal_spectrum.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIGNAL_X86 1
+#endif
+using namespace std;
+
+static const double pi = 3.141592653589793;
+
+// FFT :-
+
+// Iterative radix-2 decimation in time on split real and imaginary arrays.
+// The input arrives bit-reversed, the first two stages (twiddles 1 and -i)
+// run as one radix-4 pass, and every later stage of span h walks h
+// contiguous twiddles, which is what the vector kernels load; they take two
+// stages per pass over the data where they can. All kernels do the same
+// multiplies and adds in the same order, so they agree exactly.
+
+typedef void (*StageKernel)(double* re, double* im, size_t m, size_t h,
+                            const double* wr, const double* wi);
+typedef void (*SplitKernel)(const double* re, const double* im, size_t m,
+                            const double* wr, const double* wi, double* out);
+
+static void fftStageScalar(double* re, double* im, size_t m, size_t h,
+                           const double* wr, const double* wi) {
+    for (size_t b = 0; b < m; b += 2 * h) {
+        double* ar = re + b;
+        double* ai = im + b;
+        double* br = ar + h;
+        double* bi = ai + h;
+        for (size_t j = 0; j < h; j++) {
+            double tr = br[j] * wr[j] - bi[j] * wi[j];
+            double ti = br[j] * wi[j] + bi[j] * wr[j];
+            br[j] = ar[j] - tr;
+            bi[j] = ai[j] - ti;
+            ar[j] = ar[j] + tr;
+            ai[j] = ai[j] + ti;
+        }
+    }
+}
+
+// Spans h and 2h; wr and wi point at the span h twiddles, which are followed
+// by the span 2h ones.
+static void fftPairScalar(double* re, double* im, size_t m, size_t h,
+                          const double* wr, const double* wi) {
+    fftStageScalar(re, im, m, h, wr, wi);
+    fftStageScalar(re, im, m, 2 * h, wr + h, wi + h);
+}
+
+// X[k] and X[m-k] from Z[k] and Z[m-k] for k in [from, m/2].
+static void splitBins(const double* re, const double* im, size_t m, size_t from,
+                      const double* wr, const double* wi, double* out) {
+    for (size_t k = from; k <= m / 2; k++) {
+        double er = 0.5 * (re[k] + re[m - k]), ei = 0.5 * (im[k] - im[m - k]);
+        double or_ = 0.5 * (im[k] + im[m - k]), oi = 0.5 * (re[m - k] - re[k]);
+        double tr = wr[k] * or_ - wi[k] * oi;
+        double ti = wr[k] * oi + wi[k] * or_;
+        out[k] += (er + tr) * (er + tr) + (ei + ti) * (ei + ti);
+        if (k != m - k) out[m - k] += (er - tr) * (er - tr) + (ei - ti) * (ei - ti);
+    }
+}
+
+static void fftSplitScalar(const double* re, const double* im, size_t m,
+                           const double* wr, const double* wi, double* out) {
+    splitBins(re, im, m, 1, wr, wi, out);
+}
+
+#ifdef SIGNAL_X86
+
+__attribute__((target("sse2")))
+static void fftStageSSE2(double* re, double* im, size_t m, size_t h,
+                         const double* wr, const double* wi) {
+    if (h < 2) {
+        fftStageScalar(re, im, m, h, wr, wi);
+        return;
+    }
+    for (size_t b = 0; b < m; b += 2 * h) {
+        double* ar = re + b;
+        double* ai = im + b;
+        double* br = ar + h;
+        double* bi = ai + h;
+        for (size_t j = 0; j < h; j += 2) {
+            __m128d xr = _mm_loadu_pd(br + j), xi = _mm_loadu_pd(bi + j);
+            __m128d cr = _mm_loadu_pd(wr + j), ci = _mm_loadu_pd(wi + j);
+            __m128d tr = _mm_sub_pd(_mm_mul_pd(xr, cr), _mm_mul_pd(xi, ci));
+            __m128d ti = _mm_add_pd(_mm_mul_pd(xr, ci), _mm_mul_pd(xi, cr));
+            __m128d yr = _mm_loadu_pd(ar + j), yi = _mm_loadu_pd(ai + j);
+            _mm_storeu_pd(br + j, _mm_sub_pd(yr, tr));
+            _mm_storeu_pd(bi + j, _mm_sub_pd(yi, ti));
+            _mm_storeu_pd(ar + j, _mm_add_pd(yr, tr));
+            _mm_storeu_pd(ai + j, _mm_add_pd(yi, ti));
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+static void fftPairSSE2(double* re, double* im, size_t m, size_t h,
+                        const double* wr, const double* wi) {
+    fftStageSSE2(re, im, m, h, wr, wi);
+    fftStageSSE2(re, im, m, 2 * h, wr + h, wi + h);
+}
+
+__attribute__((target("avx2")))
+static inline void butterflyAVX2(__m256d& ar, __m256d& ai, __m256d& br, __m256d& bi,
+                                 __m256d wr, __m256d wi) {
+    __m256d tr = _mm256_sub_pd(_mm256_mul_pd(br, wr), _mm256_mul_pd(bi, wi));
+    __m256d ti = _mm256_add_pd(_mm256_mul_pd(br, wi), _mm256_mul_pd(bi, wr));
+    br = _mm256_sub_pd(ar, tr);
+    bi = _mm256_sub_pd(ai, ti);
+    ar = _mm256_add_pd(ar, tr);
+    ai = _mm256_add_pd(ai, ti);
+}
+
+__attribute__((target("avx2")))
+static void fftStageAVX2(double* re, double* im, size_t m, size_t h,
+                         const double* wr, const double* wi) {
+    if (h < 4) {
+        fftStageSSE2(re, im, m, h, wr, wi);
+        return;
+    }
+    for (size_t b = 0; b < m; b += 2 * h) {
+        for (size_t j = b; j < b + h; j += 4) {
+            __m256d ar = _mm256_loadu_pd(re + j), ai = _mm256_loadu_pd(im + j);
+            __m256d br = _mm256_loadu_pd(re + j + h), bi = _mm256_loadu_pd(im + j + h);
+            butterflyAVX2(ar, ai, br, bi, _mm256_loadu_pd(wr + j - b), _mm256_loadu_pd(wi + j - b));
+            _mm256_storeu_pd(re + j, ar);
+            _mm256_storeu_pd(im + j, ai);
+            _mm256_storeu_pd(re + j + h, br);
+            _mm256_storeu_pd(im + j + h, bi);
+        }
+    }
+    _mm256_zeroupper();
+}
+
+// Both stages on four quarters held in registers: one load and one store
+// per point instead of two.
+__attribute__((target("avx2")))
+static void fftPairAVX2(double* re, double* im, size_t m, size_t h,
+                        const double* wr, const double* wi) {
+    if (h < 4) {
+        fftPairSSE2(re, im, m, h, wr, wi);
+        return;
+    }
+    const double* vr = wr + h;
+    const double* vi = wi + h;
+    for (size_t b = 0; b < m; b += 4 * h) {
+        for (size_t j = b; j < b + h; j += 4) {
+            __m256d r0 = _mm256_loadu_pd(re + j), i0 = _mm256_loadu_pd(im + j);
+            __m256d r1 = _mm256_loadu_pd(re + j + h), i1 = _mm256_loadu_pd(im + j + h);
+            __m256d r2 = _mm256_loadu_pd(re + j + 2 * h), i2 = _mm256_loadu_pd(im + j + 2 * h);
+            __m256d r3 = _mm256_loadu_pd(re + j + 3 * h), i3 = _mm256_loadu_pd(im + j + 3 * h);
+            __m256d cr = _mm256_loadu_pd(wr + j - b), ci = _mm256_loadu_pd(wi + j - b);
+            butterflyAVX2(r0, i0, r1, i1, cr, ci);
+            butterflyAVX2(r2, i2, r3, i3, cr, ci);
+            butterflyAVX2(r0, i0, r2, i2, _mm256_loadu_pd(vr + j - b), _mm256_loadu_pd(vi + j - b));
+            butterflyAVX2(r1, i1, r3, i3, _mm256_loadu_pd(vr + j - b + h), _mm256_loadu_pd(vi + j - b + h));
+            _mm256_storeu_pd(re + j, r0);
+            _mm256_storeu_pd(im + j, i0);
+            _mm256_storeu_pd(re + j + h, r1);
+            _mm256_storeu_pd(im + j + h, i1);
+            _mm256_storeu_pd(re + j + 2 * h, r2);
+            _mm256_storeu_pd(im + j + 2 * h, i2);
+            _mm256_storeu_pd(re + j + 3 * h, r3);
+            _mm256_storeu_pd(im + j + 3 * h, i3);
+        }
+    }
+    _mm256_zeroupper();
+}
+
+// Four k at a time, with the m-k side loaded and stored reversed, until the
+// two sides would meet.
+__attribute__((target("avx2")))
+static void fftSplitAVX2(const double* re, const double* im, size_t m,
+                         const double* wr, const double* wi, double* out) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    size_t k = 1;
+    for (; 2 * k + 6 < m; k += 4) {
+        size_t r = m - k - 3;
+        __m256d ar = _mm256_loadu_pd(re + k), ai = _mm256_loadu_pd(im + k);
+        __m256d br = _mm256_permute4x64_pd(_mm256_loadu_pd(re + r), 0x1B);
+        __m256d bi = _mm256_permute4x64_pd(_mm256_loadu_pd(im + r), 0x1B);
+        __m256d er = _mm256_mul_pd(half, _mm256_add_pd(ar, br));
+        __m256d ei = _mm256_mul_pd(half, _mm256_sub_pd(ai, bi));
+        __m256d odr = _mm256_mul_pd(half, _mm256_add_pd(ai, bi));
+        __m256d odi = _mm256_mul_pd(half, _mm256_sub_pd(br, ar));
+        __m256d cr = _mm256_loadu_pd(wr + k), ci = _mm256_loadu_pd(wi + k);
+        __m256d tr = _mm256_sub_pd(_mm256_mul_pd(cr, odr), _mm256_mul_pd(ci, odi));
+        __m256d ti = _mm256_add_pd(_mm256_mul_pd(cr, odi), _mm256_mul_pd(ci, odr));
+        __m256d pr = _mm256_add_pd(er, tr), pi = _mm256_add_pd(ei, ti);
+        __m256d qr = _mm256_sub_pd(er, tr), qi = _mm256_sub_pd(ei, ti);
+        __m256d p = _mm256_add_pd(_mm256_mul_pd(pr, pr), _mm256_mul_pd(pi, pi));
+        __m256d q = _mm256_add_pd(_mm256_mul_pd(qr, qr), _mm256_mul_pd(qi, qi));
+        _mm256_storeu_pd(out + k, _mm256_add_pd(_mm256_loadu_pd(out + k), p));
+        _mm256_storeu_pd(out + r, _mm256_add_pd(_mm256_loadu_pd(out + r), _mm256_permute4x64_pd(q, 0x1B)));
+    }
+    _mm256_zeroupper();
+    splitBins(re, im, m, k, wr, wi, out);
+}
+
+#endif
+
+// Spans 1 and 2 together: twiddle 1, then 1 and -i.
+static void fftRadix4(double* re, double* im, size_t m) {
+    for (size_t b = 0; b < m; b += 4) {
+        double r0 = re[b] + re[b + 1], i0 = im[b] + im[b + 1];
+        double r1 = re[b] - re[b + 1], i1 = im[b] - im[b + 1];
+        double r2 = re[b + 2] + re[b + 3], i2 = im[b + 2] + im[b + 3];
+        double r3 = re[b + 2] - re[b + 3], i3 = im[b + 2] - im[b + 3];
+        re[b] = r0 + r2;
+        im[b] = i0 + i2;
+        re[b + 2] = r0 - r2;
+        im[b + 2] = i0 - i2;
+        re[b + 1] = r1 + i3;    // -i (r3 + i i3) = i3 - i r3
+        im[b + 1] = i1 - r3;
+        re[b + 3] = r1 - i3;
+        im[b + 3] = i1 + r3;
+    }
+}
+
+RealFFT::RealFFT(size_t size) : n(size) {
+    size_t m = n / 2;
+    int levels = 0;
+    while (((size_t)1 << levels) < m) levels++;
+
+    slot.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        size_t k = i >> 1, r = 0;
+        for (int b = 0; b < levels; b++) r |= (k >> b & 1) << (levels - 1 - b);
+        slot[i] = (uint32_t)((i & 1) * m + r);
+    }
+
+    twiddleRe.resize(m);
+    twiddleIm.resize(m);
+    for (size_t h = 1; h < m; h *= 2) {
+        for (size_t j = 0; j < h; j++) {
+            twiddleRe[h + j] = cos(pi * j / h);
+            twiddleIm[h + j] = -sin(pi * j / h);
+        }
+    }
+    splitRe.resize(m);
+    splitIm.resize(m);
+    for (size_t k = 0; k < m; k++) {
+        splitRe[k] = cos(2.0 * pi * k / n);
+        splitIm[k] = -sin(2.0 * pi * k / n);
+    }
+}
+
+// The even samples went into the real parts and the odd into the imaginary
+// parts, so Z = E + iO. With A = Z[k] and B = conj Z[m-k], E = (A + B)/2 and
+// O = (A - B)/2i give X[k] = E + W^k O and X[m-k] = conj(E - W^k O).
+void RealFFT::transform(double* work, double* out) const {
+    // Picked on every transform, so setSimdLevel() reaches them like the
+    // core kernels.
+#ifdef SIGNAL_X86
+    StageKernel fftStage = pickKernel(fftStageAVX2, fftStageSSE2, fftStageScalar);
+    StageKernel fftPair = pickKernel(fftPairAVX2, fftPairSSE2, fftPairScalar);
+    SplitKernel fftSplit = pickKernel(fftSplitAVX2, fftSplitScalar, fftSplitScalar);
+#else
+    StageKernel fftStage = fftStageScalar;
+    StageKernel fftPair = fftPairScalar;
+    SplitKernel fftSplit = fftSplitScalar;
+#endif
+    size_t m = n / 2;
+    double* re = work;
+    double* im = work + m;
+    if (m >= 4) fftRadix4(re, im, m);
+    else fftStageScalar(re, im, m, 1, &twiddleRe[1], &twiddleIm[1]);
+    size_t h = 4;
+    for (; 4 * h <= m; h *= 4) fftPair(re, im, m, h, &twiddleRe[h], &twiddleIm[h]);
+    if (h < m) fftStage(re, im, m, h, &twiddleRe[h], &twiddleIm[h]);
+
+    out[0] += (re[0] + im[0]) * (re[0] + im[0]);
+    out[m] += (re[0] - im[0]) * (re[0] - im[0]);
+    fftSplit(re, im, m, splitRe.data(), splitIm.data(), out);
+}
+
+void RealFFT::power(const double* x, double* work, double* out) const {
+    for (size_t i = 0; i < n; i++) work[slot[i]] = x[i];
+    fill(out, out + n / 2 + 1, 0.0);
+    transform(work, out);
+}
+
+// WELCH :-
+
+// Bits [first, first + 64) of a plane, zeros past its end.
+static inline uint64_t planeWord(const BitStream& plane, size_t first) {
+    size_t w = first >> 6, shift = first & 63;
+    size_t words = plane.words.size();
+    uint64_t lo = w < words ? plane.words[w] >> shift : 0;
+    uint64_t hi = shift && w + 1 < words ? plane.words[w + 1] << (64 - shift) : 0;
+    return lo | hi;
+}
+
+// Levels of symbols [first, first + n) as doubles.
+static void readLevels(const SymbolStream& symbols, size_t first, size_t n, double* out) {
+    for (size_t i = 0; i < n; i += 64) {
+        uint64_t p = planeWord(symbols.pos, first + i);
+        uint64_t q = symbols.ternary ? planeWord(symbols.neg, first + i) : ~p;
+        size_t count = min((size_t)64, n - i);
+        for (size_t b = 0; b < count; b++) out[i + b] = (double)((int)(p >> b & 1) - (int)(q >> b & 1));
+    }
+}
+
+bool welchPSD(const SymbolStream& symbols, const SpectrumParams& params, Spectrum& spectrum) {
+    size_t perSymbol = (size_t)max(1, params.samplesPerSymbol);
+    size_t total = symbols.size() * perSymbol;
+    size_t length = 16;
+    while (length * 2 <= min(params.segment, total)) length *= 2;
+    if (total < length) return false;
+
+    // Hops are whole symbols, so every segment has the same sample layout.
+    double overlap = min(max(params.overlap, 0.0), 0.95);
+    size_t hopSymbols = max((size_t)1, (size_t)floor(length * (1.0 - overlap) / perSymbol + 0.5));
+    size_t hop = hopSymbols * perSymbol;
+    size_t segments = (total - length) / hop + 1;
+    size_t span = (length + perSymbol - 1) / perSymbol;
+
+    RealFFT fft(length);
+    vector<double> window(length);
+    vector<uint32_t> symbolOf(length);
+    double windowPower = 0.0;
+    for (size_t i = 0; i < length; i++) {
+        window[i] = 0.5 - 0.5 * cos(2.0 * pi * i / length);
+        windowPower += window[i] * window[i];
+        symbolOf[i] = (uint32_t)(i / perSymbol);
+    }
+
+    unsigned threads = params.threads ? params.threads : max(1u, thread::hardware_concurrency());
+    threads = (unsigned)min((size_t)threads, segments);
+    size_t bins = length / 2 + 1;
+    vector<vector<double> > sums(threads, vector<double>(bins, 0.0));
+
+    // One contiguous run of segments per worker, so the result depends only
+    // on the thread count and each worker reads its own stretch of symbols.
+    auto work = [&](unsigned t) {
+        size_t first = segments * t / threads, end = segments * (t + 1) / threads;
+        vector<double> buffer(length);
+        vector<double> levels(span);
+        const uint32_t* slot = fft.slots().data();
+        double* sum = sums[t].data();
+        for (size_t s = first; s < end; s++) {
+            readLevels(symbols, s * hopSymbols, span, levels.data());
+            for (size_t i = 0; i < length; i++) buffer[slot[i]] = window[i] * levels[symbolOf[i]];
+            fft.transform(buffer.data(), sum);
+        }
+    };
+    vector<thread> workers;
+    for (unsigned t = 1; t < threads; t++) workers.push_back(thread(work, t));
+    work(0);
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+    // One-sided: every bin but DC and Nyquist carries its negative twin.
+    double sampleRate = params.symbolRate * perSymbol;
+    double scale = 1.0 / (sampleRate * windowPower * segments);
+    spectrum.frequency.resize(bins);
+    spectrum.density.resize(bins);
+    spectrum.binWidth = sampleRate / length;
+    spectrum.segments = segments;
+    for (size_t k = 0; k < bins; k++) {
+        double sum = 0.0;
+        for (unsigned t = 0; t < threads; t++) sum += sums[t][k];
+        spectrum.frequency[k] = k * spectrum.binWidth;
+        spectrum.density[k] = sum * scale * (k == 0 || k == bins - 1 ? 1.0 : 2.0);
+    }
+    return true;
+}
+
+// BANDWIDTH :-
+
+// The first bin at which the running sum reaches share of the total.
+static double occupiedBelow(const Spectrum& spectrum, double share, double total) {
+    double sum = 0.0;
+    for (size_t k = 0; k < spectrum.density.size(); k++) {
+        sum += spectrum.density[k];
+        if (sum >= share * total) return spectrum.frequency[k];
+    }
+    return spectrum.frequency.back();
+}
+
+BandwidthReport measureBandwidth(const Spectrum& spectrum, double symbolRate) {
+    BandwidthReport report = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    const vector<double>& d = spectrum.density;
+    size_t bins = d.size(), peak = 0;
+    double total = 0.0, low = 0.0;
+    for (size_t k = 0; k < bins; k++) {
+        total += d[k];
+        if (spectrum.frequency[k] < 0.1 * symbolRate) low += d[k];
+        if (d[k] > d[peak]) peak = k;
+    }
+    if (total <= 0.0) return report;
+
+    report.power = total * spectrum.binWidth;
+    report.peakFrequency = spectrum.frequency[peak];
+    // Both off the one-sided density, as plotted, so at most 0 dB.
+    report.dcLevel = 10.0 * log10(max(d[0] / d[peak], 1e-30));
+    report.lowFraction = low / total;
+    for (size_t k = peak + 1; k + 1 < bins; k++) {
+        if (d[k] < d[peak] * 1e-3 && d[k] <= d[k - 1] && d[k] <= d[k + 1]) {
+            report.firstNull = spectrum.frequency[k];
+            break;
+        }
+    }
+    report.occupied90 = occupiedBelow(spectrum, 0.90, total);
+    report.occupied99 = occupiedBelow(spectrum, 0.99, total);
+    return report;
+}
+
+void printBandwidth(ostream& out, const BandwidthReport& report, const char* unit) {
+    out << "Mean power: " << report.power << endl;
+    out << "Spectral peak: " << report.peakFrequency << " " << unit << endl;
+    out << "DC level: " << report.dcLevel << " dB from the peak, "
+        << report.lowFraction * 100.0 << "% of the power below 0.1 x symbol rate" << endl;
+    if (report.firstNull > 0.0) out << "First null: " << report.firstNull << " " << unit << endl;
+    out << "Bandwidth: 90% of the power below " << report.occupied90 << ", 99% below "
+        << report.occupied99 << " " << unit << endl;
+}
+
+bool writeSpectrumCSV(const Spectrum& spectrum, const string& path) {
+    FILE* f = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if (!f) return false;
+    fputs("frequency,density,density_db\n", f);
+    for (size_t k = 0; k < spectrum.density.size(); k++) {
+        double d = spectrum.density[k];
+        fprintf(f, "%.9g,%.9g,%.4f\n", spectrum.frequency[k], d, 10.0 * log10(max(d, 1e-300)));
+    }
+    if (f == stdout) return fflush(f) == 0;
+    return fclose(f) == 0;
+}
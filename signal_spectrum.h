@@ -0,0 +1,87 @@
+#ifndef SIGNAL_SPECTRUM_H
+#define SIGNAL_SPECTRUM_H
+
+// Power spectral density of encoded line symbols by Welch's method, on a
+// built-in FFT, and the bandwidth figures used to compare line codes: DC
+// content, first null and the band holding 90% and 99% of the power.
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "signal_core.h"
+
+// FFT :-
+
+// |X[k]|^2 for k = 0..n/2 of n real samples, n a power of two of at least 4,
+// through a complex FFT of n/2 points. The tables are read-only once built,
+// so one object can serve any number of threads, each with its own work.
+class RealFFT {
+public:
+    RealFFT(size_t n);
+
+    size_t size() const { return n; }
+    // Where sample i goes in work before transform(); the complex FFT runs
+    // on bit-reversed input, so loading through this costs no extra pass.
+    const std::vector<uint32_t>& slots() const { return slot; }
+    // work holds n doubles, filled through slots() and clobbered; the n/2 + 1
+    // powers are added to out, so periodograms can be summed in place.
+    void transform(double* work, double* out) const;
+    // One block of n samples, with out overwritten.
+    void power(const double* x, double* work, double* out) const;
+
+private:
+    size_t n;
+    std::vector<uint32_t> slot;
+    std::vector<double> twiddleRe, twiddleIm;   // stage of span h at [h, 2h)
+    std::vector<double> splitRe, splitIm;       // e^-2 pi i k/n, k < n/2
+};
+
+// WELCH :-
+
+struct SpectrumParams {
+    size_t segment;         // FFT length in samples, a power of two
+    int samplesPerSymbol;   // each symbol is held for this many samples
+    double overlap;         // share of a segment repeated in the next, [0, 1)
+    double symbolRate;      // symbols per second; sets the frequency unit
+    unsigned threads;       // 0 uses every core
+
+    SpectrumParams()
+        : segment(1024), samplesPerSymbol(8), overlap(0.5), symbolRate(1.0), threads(0) {}
+};
+
+struct Spectrum {
+    std::vector<double> frequency;   // bin centres, 0 up to half the sample rate
+    std::vector<double> density;     // one-sided, power per unit frequency
+    double binWidth;
+    size_t segments;
+
+    Spectrum() : binWidth(0.0), segments(0) {}
+};
+
+// Hann-windowed segments, averaged periodograms. Segments start on symbol
+// boundaries and are filled straight from the packed planes, so the
+// upsampled signal is never stored; they are shared out in batches over the
+// worker threads. The segment shrinks for short streams; false if there are
+// fewer than 16 samples. The density integrates to the mean square level.
+bool welchPSD(const SymbolStream& symbols, const SpectrumParams& params, Spectrum& spectrum);
+
+// BANDWIDTH :-
+
+struct BandwidthReport {
+    double power;          // mean square level, the integral of the density
+    double peakFrequency;
+    double dcLevel;        // density at 0 relative to the peak, dB; 0 when DC is the peak
+    double lowFraction;    // share of the power below 10% of the symbol rate
+    double firstNull;      // first dip 30 dB under the peak; 0 if none
+    double occupied90;     // lowest frequency with 90% of the power below it
+    double occupied99;
+};
+
+BandwidthReport measureBandwidth(const Spectrum& spectrum, double symbolRate);
+void printBandwidth(std::ostream& out, const BandwidthReport& report, const char* unit);
+
+// frequency,density,density_db rows; '-' writes to stdout.
+bool writeSpectrumCSV(const Spectrum& spectrum, const std::string& path);
+
+#endif
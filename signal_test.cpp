@@ -0,0 +1,385 @@
+#include <iostream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "signal_core.h"
+#include "signal_codes.h"
+#include "signal_source.h"
+#include "signal_spectrum.h"
+using namespace std;
+
+// Checks the word-parallel kernels in every SIMD version, the streaming and
+// chunked encoders and the decoders against the per-bit rules in
+// signal_codes.h, for every line code, and the sine generator, the FFT and
+// the spectrum's DC figure at every level. Prints each mismatch and exits with 1 if there was
+// any.
+
+//CHECKS:-
+
+int failures = 0;
+
+void check(bool ok, const string& what) {
+    if (ok) return;
+    if (++failures <= 50) cerr << "FAIL: " << what << "\n";
+}
+
+string where(LineCode code, const char* pattern, size_t n) {
+    return string(codeName(code)) + ", " + pattern + ", " + to_string(n) + " bits";
+}
+
+bool sameBits(BitView a, BitView b) {
+    if (a.size() != b.size()) return false;
+    for (size_t w = 0; w < (a.size() + 63) / 64; w++) {
+        if (a.words[w] != b.words[w]) return false;
+    }
+    return true;
+}
+
+//PATTERNS:-
+
+enum Pattern { PATTERN_RANDOM, PATTERN_ZEROS, PATTERN_ONES, PATTERN_ALTERNATING, PATTERN_ZERO_RUNS };
+const char* patternNames[] = { "random", "zeros", "ones", "alternating", "zero-runs" };
+const int patternCount = 5;
+
+// Zero runs of 1 to 20 bits put B8ZS and HDB3 substitutions, and the zeros
+// they hold back, across every word and block edge sooner or later.
+void makeBits(Pattern pattern, size_t n, BitStream& bits, mt19937_64& rng) {
+    bits.clear();
+    bits.resize(n);
+    for (size_t w = 0; w < bits.words.size(); w++) {
+        if (pattern == PATTERN_RANDOM) bits.words[w] = rng();
+        else if (pattern == PATTERN_ONES) bits.words[w] = ~0ULL;
+        else if (pattern == PATTERN_ALTERNATING) bits.words[w] = 0xAAAAAAAAAAAAAAAAULL;
+    }
+    if (pattern == PATTERN_ZERO_RUNS) {
+        for (size_t i = rng() % 8; i < n; i += 1 + rng() % 21) bits.set(i, 1);
+    }
+    if (n & 63) bits.words.back() &= (1ULL << (n & 63)) - 1;
+}
+
+// The reference: the scheme's per-bit loop.
+vector<int> reference(LineCode code, BitView bits) {
+    vector<int> out(bits.size() * symbolsPerBit(code));
+    withScheme(code, [&](auto scheme) { encode<decltype(scheme)>(bits, out.data()); });
+    return out;
+}
+
+//ENCODING:-
+
+// Bit lengths around word, block and pair edges: the parity and plane
+// kernels work 64 words at a time, the decoders 4096 symbols at a time.
+const size_t lengths[] = {
+    0, 1, 2, 7, 8, 9, 63, 64, 65, 127, 128, 129, 2047, 2048, 2049,
+    4095, 4096, 4097, 8191, 8192, 8193, 70001
+};
+
+void checkEncoders(LineCode code, Pattern pattern, const BitStream& bits, mt19937_64& rng) {
+    string at = where(code, patternNames[pattern], bits.size());
+    vector<int> ref = reference(code, bits);
+    size_t m = ref.size();
+    vector<int> out(m + 16);
+
+    encodeParallel(code, bits, out.data(), 1);
+    check(equal(ref.begin(), ref.end(), out.begin()), "encodeParallel, " + at);
+
+    // The same stream pushed in chunks of a random number of words.
+    StreamEncoder* encoder = makeEncoder(code);
+    size_t k = 0;
+    for (size_t w = 0; w * 64 < bits.size(); ) {
+        size_t words = 1 + rng() % 70;
+        size_t count = min(words * 64, bits.size() - w * 64);
+        k += encoder->push(BitView(bits).slice(w, count), out.data() + k);
+        w += words;
+    }
+    k += encoder->finish(out.data() + k);
+    delete encoder;
+    check(k == m && equal(ref.begin(), ref.end(), out.begin()), "StreamEncoder chunks, " + at);
+
+    SymbolStream packed, expected;
+    encodeSymbols(code, bits, packed);
+    packSymbols(ref.data(), m, isTernary(code), expected);
+    check(packed.ternary == isTernary(code) && sameBits(packed.pos, expected.pos) &&
+          sameBits(packed.neg, expected.neg), "encodeSymbols, " + at);
+    if (m) unpackSymbols(packed, 0, m, out.data());
+    check(equal(ref.begin(), ref.end(), out.begin()), "unpackSymbols, " + at);
+
+    BitStream decoded;
+    size_t violations = decodeSignal(code, ref.data(), m, decoded);
+    check(violations == 0 && sameBits(decoded, bits), "decodeSignal, " + at);
+    violations = decodeSignal(code, packed, decoded);
+    check(violations == 0 && sameBits(decoded, bits), "decodeSignal packed, " + at);
+}
+
+// A single-shot encoder, which runs the kernels with no streaming state
+// around them; the vector tails must not write past the last symbol.
+void checkSingleShot(LineCode code, void (*encoder)(BitView, int*), Pattern pattern,
+                     const BitStream& bits) {
+    vector<int> ref = reference(code, bits);
+    size_t m = ref.size();
+    vector<int> out(m + 16, 2);
+    encoder(bits, out.data());
+    check(equal(ref.begin(), ref.end(), out.begin()) && count(out.begin() + m, out.end(), 2) == 16,
+          "single-shot, " + where(code, patternNames[pattern], bits.size()));
+}
+
+// Every zero run of 1 to 20 bits, starting either side of a word edge, after
+// an odd and an even number of pulses: the scramblers find runs a word at a
+// time, and HDB3's substitution depends on the pulses since the last one.
+void checkZeroRuns(LineCode code, void (*scrambler)(BitView, int*)) {
+    BitStream bits;
+    vector<int> out;
+    for (size_t run = 1; run <= 20; run++) {
+        for (size_t start = 56; start <= 68; start++) {
+            for (size_t pulses = 1; pulses <= 2; pulses++) {
+                bits.clear();
+                bits.resize(start + run + 9);
+                for (size_t i = start - pulses; i < start; i++) bits.set(i, 1);
+                bits.set(start + run, 1);
+                vector<int> ref = reference(code, bits);
+                out.assign(ref.size(), 2);
+                scrambler(bits, out.data());
+                check(out == ref, where(code, "zero run", bits.size()) + ", " + to_string(run) +
+                      " zeros from bit " + to_string(start) + " after " + to_string(pulses) +
+                      " pulses");
+            }
+        }
+    }
+}
+
+// Symbols that no encoder wrote: the kernels must find the same bits and the
+// same violations as the per-bit decoder.
+void checkCorrupted(LineCode code, const BitStream& bits, mt19937_64& rng) {
+    string at = where(code, "corrupted", bits.size());
+    vector<int> symbols = reference(code, bits);
+    size_t m = symbols.size();
+    for (size_t i = 0; i < m; i++) {
+        if (rng() % 50) continue;
+        int level = (int)(rng() % 3) - 1;
+        symbols[i] = (level == 0 && !isTernary(code)) ? 1 : level;
+    }
+
+    BitStream expected, decoded;
+    size_t want = withScheme(code, [&](auto scheme) {
+        return decode<decltype(scheme)>(symbols.data(), m, expected);
+    });
+    size_t got = decodeSignal(code, symbols.data(), m, decoded);
+    check(got == want && sameBits(decoded, expected), "decodeSignal, " + at);
+    SymbolStream packed;
+    packSymbols(symbols.data(), m, isTernary(code), packed);
+    got = decodeSignal(code, packed, decoded);
+    check(got == want && sameBits(decoded, expected), "decodeSignal packed, " + at);
+}
+
+// The named decoders, on corrupted symbols and on streams cut one symbol
+// short, against the per-bit decoder.
+typedef size_t (*Decoder)(const int* symbols, size_t n, BitStream& bits);
+
+void checkDecoders(const BitStream& bits, mt19937_64& rng) {
+    const Decoder decoders[] = {
+        decodeNRZL, decodeNRZI, decodeManchester, decodeDiffManchester,
+        decodeAMI, descrambleB8ZS, descrambleHDB3
+    };
+    for (int c = LINE_NRZL; c <= LINE_HDB3; c++) {
+        LineCode code = (LineCode)c;
+        vector<int> symbols = reference(code, bits);
+        for (size_t i = 0; i < symbols.size(); i++) {
+            if (rng() % 50 == 0) symbols[i] = -symbols[i];
+        }
+        for (size_t cut = 0; cut <= min((size_t)1, symbols.size()); cut++) {
+            size_t m = symbols.size() - cut;
+            BitStream expected, decoded;
+            size_t want = withScheme(code, [&](auto scheme) {
+                return decode<decltype(scheme)>(symbols.data(), m, expected);
+            });
+            size_t got = decoders[c](symbols.data(), m, decoded);
+            check(got == want && sameBits(decoded, expected),
+                  string(codeName(code)) + " decoder, " + to_string(m) + " symbols");
+        }
+    }
+}
+
+// Violations that must be counted whatever the decoders' layout.
+void checkViolations() {
+    BitStream bits;
+    const int manchester[] = { 1, -1, 1, 1, -1, 1 };
+    check(decodeManchester(manchester, 6, bits) == 1, "Manchester pair with no mid-bit transition");
+    const int ami[] = { 1, 0, 1, -1, 0, -1 };
+    check(decodeAMI(ami, 6, bits) == 2, "AMI pulses of one polarity in a row");
+    const int b8zs[] = { 1, 0, 0, 0, 1, -1, 0, -1, 1, -1 };
+    check(descrambleB8ZS(b8zs, 10, bits) == 0 && bits.size() == 10 && bits.get(0) && bits.get(9) &&
+          !bits.get(1) && !bits.get(8), "B8ZS substitution after a positive pulse");
+    check(decodeAMI(b8zs, 10, bits) == 2, "B8ZS substitution read as AMI");
+    const int hdb3[] = { 1, 0, 0, 0, 1, -1 };
+    check(descrambleHDB3(hdb3, 6, bits) == 0 && bits.size() == 6 && !bits.get(4) && bits.get(5),
+          "HDB3 000V after a positive pulse");
+}
+
+//PARALLEL:-
+
+// encodeParallel cuts the input into chunks of whole words, at least 1024
+// each; zero runs are carved across every edge it will cut at for 1 to 8
+// threads, so held-back zeros and substitutions straddle them.
+void checkParallel(LineCode code, mt19937_64& rng) {
+    const size_t n = 8192 * 64 + 45, nWords = (n + 63) / 64;
+    BitStream bits;
+    makeBits(PATTERN_RANDOM, n, bits, rng);
+    for (size_t threads = 2; threads <= 8; threads++) {
+        size_t chunks = min(threads, nWords / 1024);
+        size_t perChunk = (nWords + chunks - 1) / chunks;
+        for (size_t edge = perChunk * 64; edge < n; edge += perChunk * 64) {
+            size_t before = rng() % 13, after = rng() % 13;
+            for (size_t i = edge - before; i < edge + after; i++) bits.set(i, 0);
+            bits.set(edge - before - 1, 1);
+            bits.set(edge + after, 1);
+        }
+    }
+
+    vector<int> ref = reference(code, bits);
+    vector<int> out(ref.size());
+    for (unsigned threads = 1; threads <= 8; threads++) {
+        fill(out.begin(), out.end(), 2);
+        encodeParallel(code, bits, out.data(), threads);
+        check(out == ref, where(code, "chunk edges", n) + ", " + to_string(threads) + " threads");
+    }
+}
+
+//MODULATION:-
+
+// The PCM range scan and quantiser, at this level against the scalar loops.
+void checkPCM(SimdLevel level, mt19937_64& rng) {
+    uniform_real_distribution<double> noise(-2.0, 2.0);
+    const size_t counts[] = { 1, 3, 4, 5, 8, 9, 17, 1000 };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        vector<double> analog(counts[c]);
+        for (size_t i = 0; i < analog.size(); i++) analog[i] = noise(rng);
+        analog[0] = -2.0;
+        if (analog.size() > 4) analog[4] = NAN;
+        for (int width = 1; width <= 16; width *= 2) {
+            BitStream want, got;
+            setSimdLevel(SIMD_SCALAR);
+            PCMEncoder scalar(width, -1.0, 1.0);
+            scalar.push(analog.data(), analog.size(), want);
+            setSimdLevel(level);
+            PCMEncoder vector(width, -1.0, 1.0);
+            vector.push(analog.data(), analog.size(), got);
+            check(sameBits(want, got), "PCMEncoder, " + to_string(analog.size()) +
+                  " samples of " + to_string(width) + " bits");
+            if (analog.size() < 5) {
+                setSimdLevel(SIMD_SCALAR);
+                encodePCM(analog.data(), analog.size(), want, width, 1);
+                setSimdLevel(level);
+                encodePCM(analog.data(), analog.size(), got, width, 1);
+                check(sameBits(want, got), "encodePCM, " + to_string(analog.size()) + " samples");
+            }
+        }
+    }
+}
+
+// sineTurns at this level against the scalar loop, bit for bit, over whole
+// and quarter turns, both signs and phases out to 2^40 turns.
+void checkSine(SimdLevel level, mt19937_64& rng) {
+    uniform_real_distribution<double> unit(-1.0, 1.0);
+    const size_t counts[] = { 1, 2, 3, 4, 5, 8, 9, 17, 1000 };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        vector<double> turns(counts[c]), want(counts[c]), got(counts[c]);
+        for (size_t i = 0; i < turns.size(); i++) {
+            if (i % 4 == 1) turns[i] = (double)(int)(rng() % 16) / 4 - 2;
+            else turns[i] = ldexp(unit(rng), (int)(rng() % 41));
+        }
+        setSimdLevel(SIMD_SCALAR);
+        sineTurns(turns.data(), turns.size(), want.data());
+        setSimdLevel(level);
+        sineTurns(turns.data(), turns.size(), got.data());
+        check(want == got, "sineTurns, " + to_string(turns.size()) + " phases");
+    }
+}
+
+//SPECTRUM:-
+
+const double pi = 3.141592653589793;
+
+// RealFFT against a direct DFT, and at this level against the scalar stages,
+// which do the same arithmetic in the same order.
+void checkFFT(SimdLevel level, mt19937_64& rng) {
+    uniform_real_distribution<double> noise(-1.0, 1.0);
+    for (size_t n = 4; n <= 4096; n *= 2) {
+        vector<double> x(n), work(n), want(n / 2 + 1), got(n / 2 + 1);
+        for (size_t i = 0; i < n; i++) x[i] = noise(rng);
+        RealFFT fft(n);
+        setSimdLevel(SIMD_SCALAR);
+        fft.power(x.data(), work.data(), want.data());
+        setSimdLevel(level);
+        fft.power(x.data(), work.data(), got.data());
+        check(want == got, "RealFFT, " + to_string(n) + " points");
+
+        double worst = 0.0;
+        for (size_t k = 0; k <= n / 2; k++) {
+            double re = 0.0, im = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                double a = 2.0 * pi * (double)((i * k) % n) / n;
+                re += x[i] * cos(a);
+                im -= x[i] * sin(a);
+            }
+            worst = max(worst, fabs(re * re + im * im - got[k]));
+        }
+        check(worst < 1e-12 * n * n, "RealFFT against the DFT, " + to_string(n) + " points");
+    }
+}
+
+// A constant level puts the spectral peak at DC, which is then 0 dB from it.
+void checkSpectrum() {
+    BitStream ones;
+    ones.resize(8192);
+    for (size_t w = 0; w < ones.words.size(); w++) ones.words[w] = ~0ULL;
+    SymbolStream symbols;
+    encodeSymbols(LINE_NRZL, ones, symbols);
+    SpectrumParams params;
+    params.threads = 1;
+    Spectrum spectrum;
+    bool ok = welchPSD(symbols, params, spectrum);
+    BandwidthReport report = measureBandwidth(spectrum, params.symbolRate);
+    check(ok && report.peakFrequency == 0.0 && fabs(report.dcLevel) < 1e-9,
+          "DC level of all-ones NRZ-L: " + to_string(report.dcLevel) + " dB");
+}
+
+//MAIN:-
+
+int main() {
+    const char* levelNames[] = { "scalar", "sse2", "avx2" };
+    mt19937_64 rng(2024);
+
+    for (int l = SIMD_SCALAR; l <= cpuSimdLevel(); l++) {
+        SimdLevel level = setSimdLevel((SimdLevel)l);
+        int before = failures;
+        BitStream bits;
+        for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+            for (int p = 0; p < patternCount; p++) {
+                makeBits((Pattern)p, lengths[i], bits, rng);
+                for (int c = 0; c < lineCodeCount; c++) checkEncoders((LineCode)c, (Pattern)p, bits, rng);
+                checkSingleShot(LINE_NRZL, encodeNRZL, (Pattern)p, bits);
+                checkSingleShot(LINE_MANCHESTER, encodeManchester, (Pattern)p, bits);
+                checkSingleShot(LINE_NRZI, encodeNRZI, (Pattern)p, bits);
+                checkSingleShot(LINE_DIFF_MANCHESTER, encodeDiffManchester, (Pattern)p, bits);
+                checkSingleShot(LINE_B8ZS, scrambleB8ZS, (Pattern)p, bits);
+                checkSingleShot(LINE_HDB3, scrambleHDB3, (Pattern)p, bits);
+                checkDecoders(bits, rng);
+            }
+            makeBits(PATTERN_RANDOM, lengths[i], bits, rng);
+            for (int c = 0; c < lineCodeCount; c++) checkCorrupted((LineCode)c, bits, rng);
+        }
+        checkViolations();
+        checkZeroRuns(LINE_B8ZS, scrambleB8ZS);
+        checkZeroRuns(LINE_HDB3, scrambleHDB3);
+        for (int c = 0; c < lineCodeCount; c++) checkParallel((LineCode)c, rng);
+        checkPCM(level, rng);
+        checkSine(level, rng);
+        checkFFT(level, rng);
+        checkSpectrum();
+        cout << levelNames[level] << ": " << (failures == before ? "ok" : "FAILED") << "\n";
+    }
+
+    if (failures) cerr << failures << " checks failed\n";
+    return failures ? 1 : 0;
+}